@@ -2,7 +2,17 @@
 #define CABASE_H
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <ctime>
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include "CAplane.h"
+#include "CArandom.h"
+#include "CAsimd.h"
+#include "CAworkers.h"
 
 
 class CAbase {
@@ -11,16 +21,33 @@ public:
     CAbase() :
         Ny(10),
         Nx(10),
-        nochanges(false)
-        { resetWorldSize(Nx, Ny, 1); }
+        nochanges(false),
+        packed(false),
+        workers(0),
+        cyclicStates(3),
+        cyclicThreshold(3),
+        cyclicMoore(true),
+        cyclicEvolved(false),
+        boundary(TORUS),
+        historySize(4096)
+        { setRule(RULE_LIFE_BIRTH, RULE_LIFE_SURVIVE); resetWorldSize(Nx, Ny, 1); }
 
     CAbase(int nx, int ny) :
         Ny(ny),
         Nx(nx),
-        nochanges(false)
-        { resetWorldSize(Nx, Ny, 1); }
+        nochanges(false),
+        packed(false),
+        workers(0),
+        cyclicStates(3),
+        cyclicThreshold(3),
+        cyclicMoore(true),
+        cyclicEvolved(false),
+        boundary(TORUS),
+        historySize(4096)
+        { setRule(RULE_LIFE_BIRTH, RULE_LIFE_SURVIVE); resetWorldSize(Nx, Ny, 1); }
 
     ~CAbase() {
+        delete workers;
     }
 
 
@@ -33,46 +60,69 @@ public:
     }
 
     int getColor(int x, int y) {
-        // get color from cell x, y
-        return worldColor[y * (Nx + 2) + x];
+        // get color from cell x, y; the color universe is also the one of the cyclic CA
+        return worldColor.isAllocated() ? worldColor.at(x, y) : 0;
     }
 
     void setColor(int x, int y, int c) {
-        // set color c into cell x, y in current color universe
-        worldColor[y * (Nx + 2) + x] = c;
+        // set color c (0 .. 255) into cell x, y in current color universe
+        needColor();
+        worldColor.at(x, y) = (uint8_t) c;
+        touch(x, y);
     }
 
     void setColorEvo(int x, int y, int c){
         // set color c into cell with coordinates x,y in evolution color universe
-        worldColorNew[y * (Nx + 2) + x] = c;
+        needColor();
+        worldColorNew.at(x, y) = (uint8_t) c;
+    }
+
+    const uint8_t *getColorRow(int y) {
+        // row y of the color universe, cell x at index x
+        needColor();
+        return worldColor.row(y);
     }
 
     int getLife(int x, int y) {
-        return worldLife[y * (Nx + 2) + x];
+        return worldLife.isAllocated() ? worldLife.at(x, y) : 0;
     }
 
     void setLife(int x, int y, int l) {
-        // set lifetime l into cell with coordinates x,y in current color universe
-        worldLife[y * (Nx + 2) + x] = l;
+        // set lifetime l (0 .. 65535) into cell with coordinates x,y in current color universe
+        needLife();
+        worldLife.at(x, y) = (uint16_t) l;
     }
 
     void setLifeEvo(int x, int y, int l) {
         // set lifetime l into cell with coordinates x,y in evolution color universe
-        worldLifeNew[y * (Nx + 2) + x] = l;
+        needLife();
+        worldLifeNew.at(x, y) = (uint16_t) l;
     }
 
     void setAlive(int x, int y, int i) {
-        // Set number i into cell with coordinates x,y in current universe
-        world[y * (Nx + 2) + x] = i;
+        // Set number i into cell with coordinates x,y in current universe; cells are int8_t,
+        // so i is clamped to -128 .. 127 (the bit-packed universe keeps only i == 1)
+        i = std::max(-128, std::min(127, i));
+        if (x >= 1 && x <= Nx && y >= 1 && y <= Ny) {
+            int old = isAlive(x, y);
+            hash ^= cellKey(y * (Nx + 2) + x, old) ^ cellKey(y * (Nx + 2) + x, packed ? i == 1 : i);
+            population += (uint64_t) (i == 1) - (uint64_t) (old == 1);
+        }
+        if (packed) setBit(bits, x, y, i == 1);
+        else world.at(x, y) = (int8_t) i;
+        touch(x, y);
     }
 
     void setAliveEvo(int x, int y, int i) {
-        // set number i into cell with coordinates x,y in evolution universe
-        worldNew[y * (Nx + 2) + x] = i;
+        // set number i into cell with coordinates x,y in evolution universe, clamped as in setAlive
+        i = std::max(-128, std::min(127, i));
+        if (packed) setBit(bitsNew, x, y, i == 1);
+        else worldNew.at(x, y) = (int8_t) i;
     }
 
     int isAlive(int x, int y) {
-        return world[y * (Nx + 2) + x];
+        if (packed) return getBit(bits, x, y);
+        return world.at(x, y);
     }
 
     bool isNotChanged() {
@@ -85,17 +135,294 @@ public:
 
     void worldEvolutionLife();
 
+    bool isBitPacked() {
+        return packed;
+    }
+
+    void setBitPacked(bool on);
+
+    int getThreads() {
+        return workers ? workers->getSize() : 1;
+    }
+
+    void setThreads(int n);
+
+    // Classic Game of Life, B3/S23
+    enum { RULE_LIFE_BIRTH = 0x008, RULE_LIFE_SURVIVE = 0x00C };
+
+    void setRule(unsigned b, unsigned s); // birth and survive masks, bit n for n neighbours (see CArule)
+
+    unsigned getBirth() {
+        return birth;
+    }
+
+    unsigned getSurvive() {
+        return survive;
+    }
+
+    bool isClassicLife() {
+        return birth == RULE_LIFE_BIRTH && survive == RULE_LIFE_SURVIVE;
+    }
+
+    // cyclic cellular automaton on the color universe: a cell in state s advances to
+    // (s + 1) % states if at least threshold of its neighbours (Moore: eight, else four)
+    // are in that state
+    void setCyclic(int states, int threshold, bool moore);
+    void worldEvolutionCyclic();
+
+    int getCyclicStates() {
+        return cyclicStates;
+    }
+
+    int getCyclicThreshold() {
+        return cyclicThreshold;
+    }
+
+    bool isCyclicMoore() {
+        return cyclicMoore;
+    }
+
+    // edges of the universe: before every generation the halo around it (the border cells)
+    // gets the cells of the opposite side (TORUS), dead cells (DEAD) or the cells at the edge
+    // themselves (MIRROR), so the kernels read all neighbours without any wrap-around
+    enum Boundary { TORUS, DEAD, MIRROR };
+
+    void setBoundary(Boundary b);
+
+    Boundary getBoundary() {
+        return boundary;
+    }
+
+    uint64_t getGeneration() {
+        // generations evolved since the last reset
+        return generation;
+    }
+
+    uint64_t getHash() {
+        // Zobrist hash of the current universe
+        return hash;
+    }
+
+    int getPeriod() {
+        // period of the cycle the universe has entered in the last generation, 0 if none was found
+        return period;
+    }
+
+    uint64_t getCycleStart() {
+        // first generation of the cycle
+        return cycleStart;
+    }
+
+    size_t getMemory() {
+        // bytes held by the universes, without the bookkeeping of the tiles
+        return world.getBytes() + worldNew.getBytes() + worldColor.getBytes() + worldColorNew.getBytes()
+               + worldLife.getBytes() + worldLifeNew.getBytes()
+               + (bits.capacity() + bitsNew.capacity()) * sizeof(uint64_t);
+    }
+
+    uint64_t getPopulation() {
+        // living cells (value 1), kept up to date by the evolution and every change of a cell
+        return population;
+    }
+
+    uint64_t getBirths() {
+        // cells born in the last generation
+        return births;
+    }
+
+    uint64_t getDeaths() {
+        // cells died in the last generation
+        return deaths;
+    }
+
+    uint64_t countPopulation(); // living cells counted anew, e.g. to check getPopulation
+
+    void setHistorySize(size_t n) {
+        // number of generations remembered for the cycle detection
+        historySize = n;
+    }
+
+    void forgetHistory() {
+        // start the cycle detection anew from the current universe, e.g. after going back in time
+        history.clear();
+        historyOrder.clear();
+        period = 0;
+        remember();
+    }
+
+    // every user of takeDirtyTiles has its own channel, so they do not take the tiles from each other
+    enum { DIRTY_RENDER = 0, DIRTY_RECORD = 1, DIRTY_REWIND = 2 };
+
+    void takeDirtyTiles(std::vector<int> &tiles, int channel = DIRTY_RENDER) {
+        // tiles changed since the last call on this channel, e.g. to repaint only them
+        const char bit = 1 << channel;
+        tiles.clear();
+        for (int t = 0; t < tilesX * tilesY; t++) {
+            if (tileDirty[t] & bit) {
+                tiles.push_back(t);
+                tileDirty[t] &= ~bit;
+            }
+        }
+    }
+
+    int getTileCount() {
+        return tilesX * tilesY;
+    }
+
+    void getTileRect(int t, int &x0, int &y0, int &x1, int &y1) {
+        // cells x0 .. x1, y0 .. y1 of tile t
+        x0 = (t % tilesX) * TILE_W + 1;
+        y0 = (t / tilesX) * TILE_H + 1;
+        x1 = std::min(x0 + TILE_W - 1, Nx);
+        y1 = std::min(y0 + TILE_H - 1, Ny);
+    }
+
+    int getRowWords() {
+        // words of 64 cells in one row for getRowBits and setRowBits
+        return (Nx + 63) / 64;
+    }
+
+    uint64_t getRowWord(int y, int w); // word w of getRowBits, e.g. the cells of one tile row
+    void getRowBits(int y, uint64_t *row); // living cells (value 1) of row y, cell x in bit x - 1
+    void setRowBits(int y, const uint64_t *row); // set row y to 0/1 cells from the bits
+
 
 private:
+    static uint64_t cellKey(int i, int v) {
+        // Zobrist key of value v in cell i (splitmix64), empty cells have none
+        if (v == 0) return 0;
+        return splitmix64Mix((((uint64_t) i << 8) | (uint8_t) v) + SPLITMIX64_GAMMA);
+    }
+
+    void remember();
+
+    void needColor() {
+        // the color and the life universe are only allocated once they are used
+        if (worldColor.isAllocated()) return;
+        worldColor.reset(Nx, Ny, 0, 0);
+        worldColorNew.reset(Nx, Ny, 0, 0);
+    }
+
+    void needLife() {
+        if (worldLife.isAllocated()) return;
+        worldLife.reset(Nx, Ny, 0, 0);
+        worldLifeNew.reset(Nx, Ny, 0, 0);
+    }
+
+    int getBit(const std::vector<uint64_t> &plane, int x, int y) {
+        // border cells are reported as -1 like in the int universe
+        if (x < 1 || x > Nx || y < 1 || y > Ny) return -1;
+        return (plane[(y - 1) * words + ((x - 1) >> 6)] >> ((x - 1) & 63)) & 1;
+    }
+
+    void setBit(std::vector<uint64_t> &plane, int x, int y, bool on) {
+        // writes into the border are ignored, there is no border in the packed universe
+        if (x < 1 || x > Nx || y < 1 || y > Ny) return;
+        uint64_t &w = plane[(y - 1) * words + ((x - 1) >> 6)];
+        uint64_t m = uint64_t(1) << ((x - 1) & 63);
+        if (on) w |= m;
+        else w &= ~m;
+    }
+
+    void touch(int x, int y) {
+        // mark the tile of cell x, y as changed, so it is evolved in the next generation
+        if (x < 1 || x > Nx || y < 1 || y > Ny) return;
+        int t = ((y - 1) / TILE_H) * tilesX + (x - 1) / TILE_W;
+        tileChanged[t] = 1;
+        tileDirty[t] = DIRTY_ALL;
+    }
+
+    template <class F> void forActiveTiles(F f);
+    bool evolveTile(int t);
+    template <unsigned B, unsigned S> bool evolveTilePacked(int t);
+    template <unsigned B, unsigned S> uint64_t evolveWordPacked(const uint64_t *rows[3], int w);
+
+    template <unsigned B, unsigned S>
+    struct PackedTileOf {
+        // evolveTilePacked compiled for the rule B / S, for pickRule
+        typedef bool (CAbase::*Type)(int);
+        static Type get() { return &CAbase::evolveTilePacked<B, S>; }
+    };
+    uint64_t copyTile(int t);
+    void findActiveTiles(bool cyclic);
+    bool evolveTileCyclic(int t, CyclicRowKernel kernel);
+    template <class T> void fillHalo(CAplane<T> &plane, T dead);
+    void fillHaloRows();
+
+    uint64_t haloWest(const uint64_t *row) {
+        // packed universe: the cell left of cell 1 of the row
+        if (boundary == TORUS) return (row[words - 1] >> ((Nx - 1) & 63)) & 1;
+        return boundary == MIRROR ? row[0] & 1 : 0;
+    }
+
+    uint64_t haloEast(const uint64_t *row) {
+        // the cell right of cell Nx
+        if (boundary == TORUS) return row[0] & 1;
+        return boundary == MIRROR ? (row[words - 1] >> ((Nx - 1) & 63)) & 1 : 0;
+    }
+
     int Ny;
     int Nx;
-    int *world;
-    int *worldNew;
-    int *worldColor;
-    int *worldColorNew;
-    int *worldLife;
-    int *worldLifeNew;
+    // planes of narrow cells with aligned, padded rows (see CAplane); only the ones in use
+    // are allocated, the int universe not while the packed one is active
+    CAplane<int8_t> world; // cell types -128 .. 127, 1 is a living cell, -1 the border (the halo while evolving)
+    CAplane<int8_t> worldNew;
+    CAplane<uint8_t> worldColor; // byte states, the border is a halo (see fillHalo)
+    CAplane<uint8_t> worldColorNew;
+    CAplane<uint16_t> worldLife; // lifetimes
+    CAplane<uint16_t> worldLifeNew;
     bool nochanges;
+
+    // Life-like rule and the kernels compiled for it, or the RULE_RUNTIME ones
+    unsigned birth;
+    unsigned survive;
+    LifeRowKernel rowKernel;
+    bool (CAbase::*packedTile)(int);
+
+    // bit-packed universe: 64 cells per word, rows without border
+    bool packed;
+    int words; // words per row
+    std::vector<uint64_t> bits;
+    std::vector<uint64_t> bitsNew;
+    std::vector<uint64_t> haloRows; // the rows above the first one and below the last one
+
+    // worker pool for the parallel evolution (0 = serial)
+    CAworkers *workers;
+
+    // cyclic cellular automaton
+    int cyclicStates;
+    int cyclicThreshold;
+    bool cyclicMoore;
+    bool cyclicEvolved; // the last generation was one of the cyclic CA
+
+    Boundary boundary;
+
+    // active tiles: only tiles next to a tile changed in the last generation are evolved.
+    // TILE_W is one word of the packed universe.
+    enum { TILE_W = 64, TILE_H = 32 };
+    int tilesX;
+    int tilesY;
+    std::vector<char> tileChanged;
+    std::vector<char> tileChangedNew;
+    enum { DIRTY_ALL = 0x7F };
+    std::vector<char> tileDirty; // one bit per channel: changed since the last takeDirtyTiles()
+    std::vector<uint64_t> tileHash; // hash change of every copied tile
+    std::vector<uint32_t> tileBirths; // births and deaths of every copied tile
+    std::vector<uint32_t> tileDeaths;
+    std::vector<int> active;
+
+    // cycle detection: hash of the universe, updated for changed cells only,
+    // and the generations at which the last historySize hashes were seen
+    uint64_t hash;
+    uint64_t generation;
+    uint64_t population;
+    uint64_t births;
+    uint64_t deaths;
+    int period;
+    uint64_t cycleStart;
+    size_t historySize;
+    std::unordered_map<uint64_t, uint64_t> history;
+    std::deque<std::pair<uint64_t, uint64_t> > historyOrder;
 };
 
 
@@ -105,117 +432,517 @@ private:
 // Any live cell with two or three live neighbours lives on to the next generation.
 // Any live cell with more than three live neighbours dies, as if by overpopulation.
 // Any dead cell with exactly three live neighbours becomes a live cell, as if by reproduction.
+//
+// Other Life-like rules only change the numbers of neighbours for birth and survival.
 
 
 inline int CAbase::cellEvolutionLife(int x, int y) {
-    // Classic Game of Life. Evolution rules for every cell. Changing only cell (x, y) for every step
+    // Game of Life with the current rule. Evolution rules for every cell. Changing only cell (x, y) for every step.
+    // The neighbours are read straight from the int universe, the halo holds the boundary (see fillHalo)
 
     int n_sum = 0;
-    int x1(0), y1(0);
 
     for (int ix = -1; ix <= 1; ix++) {
         for (int iy = -1; iy <= 1; iy++) {
             if (ix == 0 && iy == 0) continue;
-            x1 = x + ix;
-            y1 = y + iy;
-
-            if (x1 < 1) x1 = Nx;
-            if (x1 > Nx) x1 = 1;
-            if (y1 < 1) y1 = Ny;
-            if (y1 > Ny) y1 = 1;
-            if (isAlive(x1, y1) == 1) n_sum++;
+            if (world.at(x + ix, y + iy) == 1) n_sum++;
         }
     }
 
     if (isAlive(x, y) == 1) {
-        if(n_sum == 2 || n_sum == 3) setAliveEvo(x, y, 1);
+        if ((survive >> n_sum) & 1) setAliveEvo(x, y, 1);
         else setAliveEvo(x, y, 0);
     }
     else {
-        if (n_sum == 3) setAliveEvo(x, y, 1);
+        // any other cell keeps its value, also one that was changed since the last generation
+        if ((birth >> n_sum) & 1) setAliveEvo(x, y, 1);
+        else setAliveEvo(x, y, isAlive(x, y));
     }
     return 0;
 }
 
 
-inline void CAbase::resetWorldSize(int nx, int ny, bool del) {
-    // creation or re-creation new current and evolution universe with default values (0 for non-border cell and -1 for border cell)
+inline void CAbase::resetWorldSize(int nx, int ny, bool) {
+    // creation or re-creation new current and evolution universe with default values (0 for non-border cell and -1 for border cell).
+    // The planes keep their memory if it is large enough, so a reset does not allocate.
     Nx = nx;
     Ny = ny;
 
-    if (!del) {
-        delete[] world;
-        delete[] worldNew;
+    words = (Nx + 63) / 64;
+    bits.assign(packed ? Ny * words : 0, 0);
+    bitsNew.assign(packed ? Ny * words : 0, 0);
+
+    // everything is new, so every tile has to be evolved once
+    tilesX = (Nx + TILE_W - 1) / TILE_W;
+    tilesY = (Ny + TILE_H - 1) / TILE_H;
+    tileChanged.assign(tilesX * tilesY, 1);
+    tileChangedNew.assign(tilesX * tilesY, 0);
+    tileDirty.assign(tilesX * tilesY, DIRTY_ALL);
+    tileHash.assign(tilesX * tilesY, 0);
+    tileBirths.assign(tilesX * tilesY, 0);
+    tileDeaths.assign(tilesX * tilesY, 0);
+
+    hash = 0;
+    generation = 0;
+    population = 0;
+    births = 0;
+    deaths = 0;
+    period = 0;
+    cycleStart = 0;
+    history.clear();
+    historyOrder.clear();
+
+    // the int universe is not needed while the packed one is active
+    if (!packed) {
+        world.reset(Nx, Ny, 0, -1);
+        worldNew.reset(Nx, Ny, 0, -1);
+    }
 
-        // Color
-        delete[] worldColor;
-        delete[] worldColorNew;
+    // Color
+    if (worldColor.isAllocated()) {
+        worldColor.reset(Nx, Ny, 0, 0);
+        worldColorNew.reset(Nx, Ny, 0, 0);
+    }
 
-        // Life
-        delete[] worldLife;
-        delete[] worldLifeNew;
+    // Life
+    if (worldLife.isAllocated()) {
+        worldLife.reset(Nx, Ny, 0, 0);
+        worldLifeNew.reset(Nx, Ny, 0, 0);
     }
+}
 
-    world = new int[(Ny + 2) * (Nx + 2) + 1];
-    worldNew = new int[(Ny + 2) * (Nx + 2) + 1];
 
-    // Color
-    worldColor = new int[(Ny + 2) * (Nx + 2) + 1];
-    worldColorNew = new int[(Ny + 2) * (Nx + 2) + 1];
+inline void CAbase::findActiveTiles(bool cyclic) {
+    // A tile is active if it or one of its eight neighbour tiles (across the edges on the torus)
+    // changed in the last generation; all other tiles would stay as they are. tileChanged is
+    // about the universe of the last evolution, so after a switch between Life and the cyclic
+    // CA all tiles are active once.
+    if (cyclic != cyclicEvolved) {
+        std::fill(tileChanged.begin(), tileChanged.end(), 1);
+        cyclicEvolved = cyclic;
+    }
+    active.clear();
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; tx++) {
+            bool a = false;
+            for (int dy = -1; dy <= 1 && !a; dy++) {
+                for (int dx = -1; dx <= 1 && !a; dx++) {
+                    int ny = ty + dy, nx = tx + dx;
+                    if (boundary != TORUS && (ny < 0 || ny >= tilesY || nx < 0 || nx >= tilesX)) continue;
+                    a = tileChanged[((ny + tilesY) % tilesY) * tilesX + (nx + tilesX) % tilesX];
+                }
+            }
+            if (a) active.push_back(ty * tilesX + tx);
+        }
+    }
+}
 
-    // Life
-    worldLife = new int[(Ny + 2) * (Nx + 2) + 1];
-    worldLifeNew = new int[(Ny + 2) * (Nx + 2) + 1];
-
-    for (int i = 0; i <= (Ny + 2) * (Nx + 2); i++) {
-        // set border cells to -1
-        if ( (i < (Nx + 2)) || (i >= (Ny + 1) * (Nx + 2)) || (i % (Nx + 2) == 0) || (i % (Nx + 2) == (Nx + 1)) ) {
-            world[i] = -1;
-            worldNew[i] = -1;
-
-            // Color
-            worldColor[i] = -1;
-            worldColorNew[i] = -1;
-
-            // Life
-            worldLife[i] = -1;
-            worldLifeNew[i] = -1;
+
+inline void CAbase::worldEvolutionLife() {
+    // universe evolution for every cell of the active tiles (see findActiveTiles)
+    findActiveTiles(false);
+
+    if (packed) fillHaloRows();
+    else fillHalo(world, (int8_t) -1);
+
+    if (generation == 0 && history.empty()) remember();
+
+    std::fill(tileChangedNew.begin(), tileChangedNew.end(), 0);
+    // all active tiles have to be evolved before the first one can be copied
+    forActiveTiles([&](int t) {
+        tileChangedNew[t] = packed ? (this->*packedTile)(t) : evolveTile(t);
+    });
+    forActiveTiles([&](int t) {
+        if (tileChangedNew[t]) tileHash[t] = copyTile(t);
+    });
+    tileChanged.swap(tileChangedNew);
+
+    nochanges = true;
+    births = 0;
+    deaths = 0;
+    for (size_t i = 0; i < active.size(); i++) {
+        if (tileChanged[active[i]]) {
+            nochanges = false;
+            hash ^= tileHash[active[i]];
+            births += tileBirths[active[i]];
+            deaths += tileDeaths[active[i]];
+            tileDirty[active[i]] = DIRTY_ALL;
         }
-        else {
-            world[i] = 0;
-            worldNew[i] = 0;
+    }
+    population += births - deaths;
+    // if nochanges == true, there is no evolution and the universe remains constant
+
+    generation++;
+    remember();
+}
+
+
+inline void CAbase::remember() {
+    // look up the current hash in the history and add it; a hit means the universe is in a cycle
+    period = 0;
+    std::unordered_map<uint64_t, uint64_t>::iterator it = history.find(hash);
+    if (it != history.end()) {
+        period = (int) (generation - it->second);
+        cycleStart = it->second;
+    }
+    history[hash] = generation;
+    historyOrder.push_back(std::make_pair(hash, generation));
+
+    while (historyOrder.size() > historySize) {
+        // forget the oldest entry unless its hash was seen again later
+        it = history.find(historyOrder.front().first);
+        if (it != history.end() && it->second == historyOrder.front().second)
+            history.erase(it);
+        historyOrder.pop_front();
+    }
+}
+
+
+template <class F>
+inline void CAbase::forActiveTiles(F f) {
+    // call f for every active tile; in the parallel mode the list is split into bands of tiles
+    int n = (int) active.size();
+    if (!workers || n < 2) {
+        for (int i = 0; i < n; i++) f(active[i]);
+        return;
+    }
+    int bands = workers->getSize();
+    if (bands > n) bands = n;
+    workers->run(bands, [&](int b) {
+        for (int i = b * n / bands; i < (b + 1) * n / bands; i++) f(active[i]);
+    });
+}
 
-            // Color
-            worldColor[i] = 0;
-            worldColorNew[i] = 0;
 
-            // Life
-            worldLife[i] = 0;
-            worldLifeNew[i] = 0;
+inline bool CAbase::evolveTile(int t) {
+    // evolution of tile t of the int universe into the evolution universe, returns true if a cell changed.
+    // The halo holds the boundary, so the row kernel evolves whole tile rows straight from the three adjacent rows.
+    const int x0 = (t % tilesX) * TILE_W + 1, x1 = std::min(x0 + TILE_W - 1, Nx);
+    const int y0 = (t / tilesX) * TILE_H + 1, y1 = std::min(y0 + TILE_H - 1, Ny);
+
+    for (int iy = y0; iy <= y1; iy++) {
+        rowKernel(world.row(iy - 1) + x0, world.row(iy) + x0, world.row(iy + 1) + x0, worldNew.row(iy) + x0,
+                  x1 - x0 + 1, birth, survive);
+    }
+
+    for (int iy = y0; iy <= y1; iy++) {
+        if (memcmp(world.row(iy) + x0, worldNew.row(iy) + x0, x1 - x0 + 1)) return true;
+    }
+    return false;
+}
+
+
+inline uint64_t CAbase::copyTile(int t) {
+    // Copy new state of tile t to current universe, returns the change of the hash;
+    // the births and deaths of the tile are counted on the way
+    const int x0 = (t % tilesX) * TILE_W + 1, x1 = std::min(x0 + TILE_W - 1, Nx);
+    const int y0 = (t / tilesX) * TILE_H + 1, y1 = std::min(y0 + TILE_H - 1, Ny);
+
+    uint64_t delta = 0;
+    uint32_t born = 0, died = 0;
+    for (int iy = y0; iy <= y1; iy++) {
+        if (packed) {
+            uint64_t &w = bits[(iy - 1) * words + (x0 - 1) / 64];
+            uint64_t flipped = w ^ bitsNew[(iy - 1) * words + (x0 - 1) / 64];
+            born += __builtin_popcountll(flipped & ~w);
+            died += __builtin_popcountll(flipped & w);
+            w ^= flipped;
+            for (; flipped; flipped &= flipped - 1) {
+                int ix = x0 + __builtin_ctzll(flipped);
+                delta ^= cellKey(iy * (Nx + 2) + ix, 1);
+            }
+            continue;
+        }
+        int8_t *cur = world.row(iy);
+        const int8_t *next = worldNew.row(iy);
+        for (int ix = x0; ix <= x1; ix++) {
+            if (cur[ix] != next[ix]) {
+                int i = iy * (Nx + 2) + ix;
+                delta ^= cellKey(i, cur[ix]) ^ cellKey(i, next[ix]);
+                born += next[ix] == 1;
+                died += cur[ix] == 1;
+                cur[ix] = next[ix];
+            }
         }
     }
+    tileBirths[t] = born;
+    tileDeaths[t] = died;
+    return delta;
 }
 
 
-inline void CAbase::worldEvolutionLife() {
-    // universe evolution for every cell
-    for (int ix = 1; ix <= Nx; ix++) {
-        for (int iy = 1; iy <= Ny; iy++) {
-                cellEvolutionLife(ix, iy);
+inline void CAbase::setThreads(int n) {
+    // number of threads for the evolution, 1 means serial evolution
+    if (n == getThreads()) return;
+    delete workers;
+    workers = (n > 1) ? new CAworkers(n) : 0;
+}
+
+
+inline void CAbase::setRule(unsigned b, unsigned s) {
+    // the kernels compiled for a known rule, the RULE_RUNTIME ones for any other
+    birth = b & 0x1FF;
+    survive = s & 0x1FF;
+    rowKernel = lifeRowKernel(birth, survive);
+    packedTile = pickRule<PackedTileOf>(birth, survive, CompiledRules());
+
+    // the universe may evolve differently from now on
+    std::fill(tileChanged.begin(), tileChanged.end(), 1);
+    history.clear();
+    historyOrder.clear();
+    period = 0;
+}
+
+
+inline void CAbase::setBoundary(Boundary b) {
+    // the cells at the edges may evolve differently from now on
+    boundary = b;
+    std::fill(tileChanged.begin(), tileChanged.end(), 1);
+    history.clear();
+    historyOrder.clear();
+    period = 0;
+}
+
+
+inline void CAbase::setCyclic(int states, int threshold, bool moore) {
+    // states 2 .. 255, threshold 1 .. number of neighbours; cells beyond the states wrap around
+    states = std::max(2, std::min(states, 255));
+    threshold = std::max(1, std::min(threshold, moore ? 8 : 4));
+    if (states != cyclicStates && worldColor.isAllocated()) {
+        for (int y = 1; y <= Ny; y++) {
+            uint8_t *r = worldColor.row(y);
+            for (int x = 1; x <= Nx; x++)
+                r[x] %= states;
         }
+        std::fill(tileDirty.begin(), tileDirty.end(), DIRTY_ALL);
     }
+    std::fill(tileChanged.begin(), tileChanged.end(), 1); // the cells may evolve differently from now on
+    cyclicStates = states;
+    cyclicThreshold = threshold;
+    cyclicMoore = moore;
+}
+
+
+inline void CAbase::worldEvolutionCyclic() {
+    // the active tiles (see findActiveTiles) of the color universe are evolved into the
+    // evolution universe, then the two are swapped. A tile that is not active did not change
+    // when it was evolved the last time, so it is the same in both universes.
+    // The halo around the universe holds the boundary, so the row kernels run over whole
+    // tile rows; a dead halo has the state 255, which is nobody's next state.
+    const CyclicRowKernel kernel = cyclicRowKernel(cyclicMoore);
+    needColor();
+    findActiveTiles(true);
+    fillHalo(worldColor, (uint8_t) 255);
+
+    std::fill(tileChangedNew.begin(), tileChangedNew.end(), 0);
+    forActiveTiles([&](int t) {
+        tileChangedNew[t] = evolveTileCyclic(t, kernel);
+    });
+    worldColor.swap(worldColorNew);
+    tileChanged.swap(tileChangedNew);
 
     nochanges = true;
-    // Copy new state to current universe
-    for (int ix = 1; ix <= Nx; ix++) {
-        for (int iy = 1; iy <= Ny; iy++) {
-            if (world[iy * (Nx + 2) + ix] != worldNew[iy * (Nx + 2) + ix]) {
-                nochanges = false;
-            }
-            world[iy * (Nx + 2) + ix] = worldNew[iy * (Nx + 2) + ix];
+    for (size_t i = 0; i < active.size(); i++) {
+        if (tileChanged[active[i]]) {
+            nochanges = false;
+            tileDirty[active[i]] |= 1 << DIRTY_RENDER;
         }
     }
-    // if nochanges == true, there is no evolution and the universe remains constant
+    period = 0;
+    generation++;
+}
+
+
+inline bool CAbase::evolveTileCyclic(int t, CyclicRowKernel kernel) {
+    // tile t of the color universe into the evolution universe, returns true if a cell changed
+    int x0, y0, x1, y1;
+    getTileRect(t, x0, y0, x1, y1);
+    bool changed = false;
+    for (int iy = y0; iy <= y1; iy++) {
+        const uint8_t *mid = worldColor.row(iy) + x0;
+        uint8_t *out = worldColorNew.row(iy) + x0;
+        kernel(worldColor.row(iy - 1) + x0, mid, worldColor.row(iy + 1) + x0, out, x1 - x0 + 1,
+               cyclicStates, cyclicThreshold);
+        if (!changed && memcmp(mid, out, x1 - x0 + 1)) changed = true;
+    }
+    return changed;
+}
+
+
+template <class T>
+inline void CAbase::fillHalo(CAplane<T> &plane, T dead) {
+    // the border columns and rows get the cells of the boundary; the rows are copied after the
+    // columns, so the corners are right too
+    if (boundary == DEAD) {
+        for (int y = 1; y <= Ny; y++) {
+            T *r = plane.row(y);
+            r[0] = r[Nx + 1] = dead;
+        }
+        std::fill(plane.row(0), plane.row(0) + Nx + 2, dead);
+        std::fill(plane.row(Ny + 1), plane.row(Ny + 1) + Nx + 2, dead);
+        return;
+    }
+    const bool torus = boundary == TORUS;
+    for (int y = 1; y <= Ny; y++) {
+        T *r = plane.row(y);
+        r[0] = torus ? r[Nx] : r[1];
+        r[Nx + 1] = torus ? r[1] : r[Nx];
+    }
+    memcpy(plane.row(0), plane.row(torus ? Ny : 1), (Nx + 2) * sizeof(T));
+    memcpy(plane.row(Ny + 1), plane.row(torus ? 1 : Ny), (Nx + 2) * sizeof(T));
+}
+
+
+inline void CAbase::fillHaloRows() {
+    // the halo of the packed universe are only the rows above and below it, the cells left and
+    // right of a row are taken by evolveWordPacked (see haloWest and haloEast)
+    haloRows.resize(2 * words);
+    if (boundary == DEAD) {
+        std::fill(haloRows.begin(), haloRows.end(), 0);
+        return;
+    }
+    const bool torus = boundary == TORUS;
+    std::copy(&bits[(torus ? Ny - 1 : 0) * words], &bits[(torus ? Ny - 1 : 0) * words] + words, &haloRows[0]);
+    std::copy(&bits[(torus ? 0 : Ny - 1) * words], &bits[(torus ? 0 : Ny - 1) * words] + words, &haloRows[words]);
+}
+
+
+inline void CAbase::setBitPacked(bool on) {
+    // switch between int universe and bit-packed universe, living cells are kept
+    if (on == packed) return;
+
+    const int n = getRowWords();
+    std::vector<uint64_t> alive((size_t) Ny * n);
+    for (int iy = 1; iy <= Ny; iy++)
+        getRowBits(iy, &alive[(size_t) (iy - 1) * n]);
+
+    // only the current universe is carried over; color and life universes keep their content
+    if (packed) {
+        world.reset(Nx, Ny, 0, -1);
+        worldNew.reset(Nx, Ny, 0, -1);
+        std::vector<uint64_t>().swap(bits);
+        std::vector<uint64_t>().swap(bitsNew);
+    }
+    else {
+        world.release();
+        worldNew.release();
+        words = (Nx + 63) / 64;
+        bits.assign(Ny * words, 0);
+        bitsNew.assign(Ny * words, 0);
+    }
+    packed = on;
+    hash = 0; // rebuilt by setRowBits
+    population = 0;
+
+    for (int iy = 1; iy <= Ny; iy++)
+        setRowBits(iy, &alive[(size_t) (iy - 1) * n]);
+}
+
+
+inline uint64_t CAbase::countPopulation() {
+    // the packed universe counts 64 cells at once, the bits past Nx are always 0
+    uint64_t n = 0;
+    if (packed) {
+        for (size_t i = 0; i < bits.size(); i++)
+            n += __builtin_popcountll(bits[i]);
+        return n;
+    }
+    for (int y = 1; y <= Ny; y++) {
+        const int8_t *cells = world.row(y);
+        for (int x = 1; x <= Nx; x++)
+            n += cells[x] == 1;
+    }
+    return n;
+}
+
+
+inline uint64_t CAbase::getRowWord(int y, int w) {
+    if (packed) return bits[(y - 1) * words + w];
+    uint64_t v = 0;
+    const int8_t *cells = world.row(y) + 1 + w * 64;
+    for (int b = 0; b < 64 && w * 64 + b < Nx; b++)
+        if (cells[b] == 1) v |= uint64_t(1) << b;
+    return v;
+}
+
+
+inline void CAbase::getRowBits(int y, uint64_t *row) {
+    // bulk read for saving: a copy of the packed row, or the int row packed on the fly
+    const int n = getRowWords();
+    if (packed) {
+        std::copy(&bits[(y - 1) * words], &bits[(y - 1) * words] + n, row);
+        return;
+    }
+    std::fill(row, row + n, 0);
+    const int8_t *cells = world.row(y) + 1;
+    for (int x = 0; x < Nx; x++)
+        if (cells[x] == 1) row[x >> 6] |= uint64_t(1) << (x & 63);
+}
+
+
+inline void CAbase::setRowBits(int y, const uint64_t *row) {
+    // bulk write for loading: only the cells that differ update the hash and mark their tile
+    const int n = getRowWords();
+    for (int w = 0; w < n; w++) {
+        uint64_t v = row[w];
+        if (w == n - 1 && (Nx & 63)) v &= (uint64_t(1) << (Nx & 63)) - 1;
+        if (packed) {
+            // a flip between 0 and 1 changes the hash by the key of the living cell
+            uint64_t &old = bits[(y - 1) * words + w];
+            if (old == v) continue;
+            population += (uint64_t) __builtin_popcountll(v) - (uint64_t) __builtin_popcountll(old);
+            for (uint64_t d = old ^ v; d; d &= d - 1)
+                hash ^= cellKey(y * (Nx + 2) + w * 64 + __builtin_ctzll(d) + 1, 1);
+            old = v;
+            touch(w * 64 + 1, y);
+            continue;
+        }
+        for (uint64_t d = getRowWord(y, w) ^ v; d; d &= d - 1)
+            setAlive(w * 64 + __builtin_ctzll(d) + 1, y, (v >> __builtin_ctzll(d)) & 1);
+    }
+}
+
+
+template <unsigned B, unsigned S>
+inline bool CAbase::evolveTilePacked(int t) {
+    // Game of Life with rule B / S (see CAsimd.h) on tile t of the bit-packed universe; a tile is one word wide
+    const int w = t % tilesX;
+    const int y0 = (t / tilesX) * TILE_H, y1 = std::min(y0 + TILE_H, Ny);
+
+    bool changed = false;
+    for (int iy = y0; iy < y1; iy++) {
+        const uint64_t *rows[3] = {iy > 0 ? &bits[(iy - 1) * words] : &haloRows[0],
+                                   &bits[iy * words],
+                                   iy + 1 < Ny ? &bits[(iy + 1) * words] : &haloRows[words]};
+        uint64_t res = evolveWordPacked<B, S>(rows, w);
+        if (res != rows[1][w]) changed = true;
+        bitsNew[iy * words + w] = res;
+    }
+    return changed;
+}
+
+
+template <unsigned B, unsigned S>
+inline uint64_t CAbase::evolveWordPacked(const uint64_t *rows[3], int w) {
+    // Game of Life with rule B / S for the 64 cells of word w in the middle one of three rows
+    const int last = words - 1;
+    const int top = (Nx - 1) & 63; // position of the last cell in the last word of a row
+
+    uint64_t west[3], mid[3], east[3];
+    for (int r = 0; r < 3; r++) {
+        const uint64_t *row = rows[r];
+        uint64_t cur = row[w];
+        // the first and the last word take the cell beyond the edge from the boundary
+        uint64_t prev = (w > 0) ? (row[w - 1] >> 63) : haloWest(row);
+        uint64_t next = (w < last) ? ((row[w + 1] & 1) << 63) : (haloEast(row) << top);
+        west[r] = (cur << 1) | prev;
+        mid[r] = cur;
+        east[r] = (cur >> 1) | next;
+    }
+
+    uint64_t res = ruleWord<B, S>(west, mid, east, birth, survive);
+    if (w == last && top != 63) res &= (uint64_t(1) << (top + 1)) - 1;
+    return res;
 }
 
 
@@ -0,0 +1,128 @@
+#ifndef CADELTA_H
+#define CADELTA_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include "CAbase.h"
+
+
+class CAdelta {
+    // Cells flipped since the last take(): the tiles changed since then (on its own dirty
+    // channel of CAbase) are compared with a bit copy of the universe, so the cost follows
+    // the changed tiles and not the area. Only living (value 1) cells count.
+    //
+    // A delta is a list of ascending cell numbers (y - 1) * nx + x - 1, each one as LEB128
+    // varint of the distance to the previous one. Flipping is its own inverse: the same
+    // delta leads from one generation to the next and back again.
+
+public:
+    explicit CAdelta(int channel) :
+        channel(channel),
+        nx(0),
+        ny(0)
+        {}
+
+    bool matches(CAbase &ca) {
+        // the bit copy belongs to a universe of this size
+        return nx == ca.getNx() && ny == ca.getNy();
+    }
+
+    void reset(CAbase &ca); // take a bit copy of the whole universe
+    uint32_t take(CAbase &ca, std::vector<uint8_t> *bytes); // append the flips to bytes (0: only catch up)
+
+    static bool apply(CAbase &ca, const uint8_t *bytes, uint32_t count); // false at a cell outside ca
+
+private:
+    int channel;
+    int nx;
+    int ny;
+    std::vector<uint64_t> prev; // bit rows of the universe at the last take()
+    std::vector<int> tiles;
+    std::vector<int> band; // words of the changed tiles in one band of tiles
+};
+
+
+inline void CAdelta::reset(CAbase &ca) {
+    nx = ca.getNx();
+    ny = ca.getNy();
+    const int n = ca.getRowWords();
+    prev.resize((size_t) ny * n);
+    for (int y = 1; y <= ny; y++)
+        ca.getRowBits(y, &prev[(size_t) (y - 1) * n]);
+    ca.takeDirtyTiles(tiles, channel);
+}
+
+
+inline uint32_t CAdelta::take(CAbase &ca, std::vector<uint8_t> *bytes) {
+    // the tiles come in row-major order; going through every row of a band of tiles
+    // before the next band gives the flipped cells in ascending order without sorting
+    const int n = ca.getRowWords();
+    ca.takeDirtyTiles(tiles, channel);
+    size_t pos = bytes ? bytes->size() : 0;
+    uint32_t count = 0;
+    uint64_t before = 0;
+    for (size_t i = 0; i < tiles.size(); ) {
+        int x0, y0, x1, y1;
+        ca.getTileRect(tiles[i], x0, y0, x1, y1);
+        band.clear();
+        for (; i < tiles.size(); i++) {
+            int u0, v0, u1, v1;
+            ca.getTileRect(tiles[i], u0, v0, u1, v1);
+            if (v0 != y0) break;
+            for (int w = (u0 - 1) >> 6; w <= (u1 - 1) >> 6; w++)
+                if (band.empty() || band.back() < w) band.push_back(w);
+        }
+        for (int y = y0; y <= y1; y++) {
+            uint64_t *old = &prev[(size_t) (y - 1) * n];
+            for (size_t k = 0; k < band.size(); k++) {
+                const int w = band[k];
+                uint64_t cur = ca.getRowWord(y, w);
+                uint64_t d = cur ^ old[w];
+                if (!d) continue;
+                old[w] = cur;
+                if (!bytes) continue;
+                if (bytes->size() < pos + 64 * 10) bytes->resize(2 * bytes->size() + 64 * 10);
+                uint8_t *out = &(*bytes)[0];
+                for (; d; d &= d - 1) {
+                    uint64_t cell = (uint64_t) (y - 1) * nx + w * 64 + __builtin_ctzll(d);
+                    for (uint64_t v = cell - before; ; v >>= 7) {
+                        // as CAfile::putVarint, written in place
+                        if (v < 0x80) {
+                            out[pos++] = (uint8_t) v;
+                            break;
+                        }
+                        out[pos++] = (uint8_t) (v | 0x80);
+                    }
+                    before = cell;
+                    count++;
+                }
+            }
+        }
+    }
+    if (bytes) bytes->resize(pos);
+    return count;
+}
+
+
+inline bool CAdelta::apply(CAbase &ca, const uint8_t *bytes, uint32_t count) {
+    const uint64_t nx = ca.getNx();
+    const uint64_t cells = nx * ca.getNy();
+    uint64_t cell = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t gap = 0;
+        for (int shift = 0; ; shift += 7) {
+            gap |= (uint64_t) (*bytes & 0x7F) << shift;
+            if (!(*bytes++ & 0x80)) break;
+        }
+        cell += gap;
+        if (gap > cells || cell >= cells)
+            return false; // the flips were taken from a larger universe
+        int x = (int) (cell % nx) + 1, y = (int) (cell / nx) + 1;
+        ca.setAlive(x, y, ca.isAlive(x, y) == 1 ? 0 : 1);
+    }
+    return true;
+}
+
+
+#endif // CADELTA_H
@@ -0,0 +1,170 @@
+#ifndef CAENSEMBLE_H
+#define CAENSEMBLE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "CAbase.h"
+#include "CArandom.h"
+#include "CAworkers.h"
+
+
+class CAensemble {
+    // Many independent Life runs from random universes, e.g. a sweep over sizes and densities.
+    // A run evolves until the universe is constant or in a cycle (or maxGenerations) and
+    // reports when that happened and its final and peak population.
+    //
+    // Every thread of the pool has one universe of its own and takes the next run as soon as
+    // it is done with one, so slow runs do not hold up the others. A universe is reset for
+    // every run and keeps its memory (see CAplane), so the runs do not allocate. Every run
+    // is filled from its own seed, the results do not depend on the number of threads.
+
+public:
+    struct Task {
+        int size;
+        double density;
+    };
+
+    struct Run {
+        int task; // index into the tasks of run()
+        int index; // number of the run within its task
+        uint64_t seed;
+        uint64_t generations; // generations evolved
+        bool stable; // constant or in a cycle before maxGenerations
+        uint64_t stableGeneration; // first generation of the constant universe or of the cycle
+        int period; // 1 constant, > 1 cycle, 0 not stable
+        uint64_t population; // at the end
+        uint64_t peakPopulation;
+        uint64_t peakGeneration;
+    };
+
+    typedef std::function<void(const Run &)> RunCallback;
+
+    explicit CAensemble(int threads) :
+        workers(threads),
+        universes(workers.getSize()),
+        birth(CAbase::RULE_LIFE_BIRTH),
+        survive(CAbase::RULE_LIFE_SURVIVE),
+        seconds(0)
+        {}
+
+    void setRule(unsigned b, unsigned s) {
+        // birth and survive masks of all runs (see CArule), B3/S23 by default
+        birth = b;
+        survive = s;
+    }
+
+    // runs runs per task; done is called for every finished run as soon as it is finished
+    // (one at a time, in no particular order), e.g. to stream the results into a file
+    const std::vector<Run> &run(const std::vector<Task> &tasks, int runs, uint64_t seed,
+                                uint64_t maxGenerations, const RunCallback &done = RunCallback());
+
+    double getSeconds() {
+        return seconds;
+    }
+
+private:
+    static void fill(CAbase &ca, double density, uint64_t seed);
+    static void evolve(CAbase &ca, uint64_t maxGenerations, Run &r);
+
+    CAworkers workers;
+    std::vector<std::unique_ptr<CAbase> > universes; // one per thread
+    std::vector<Run> results;
+    unsigned birth;
+    unsigned survive;
+    double seconds;
+};
+
+
+inline const std::vector<CAensemble::Run> &CAensemble::run(const std::vector<Task> &tasks, int runs, uint64_t seed,
+                                                           uint64_t maxGenerations, const RunCallback &done) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const int total = (int) tasks.size() * std::max(runs, 0);
+    results.assign(total, Run());
+    std::atomic<int> next(0);
+    std::mutex doneMutex;
+
+    workers.run(workers.getSize(), [&](int w) {
+        if (!universes[w]) {
+            universes[w].reset(new CAbase());
+            universes[w]->setBitPacked(true);
+        }
+        CAbase &ca = *universes[w];
+        ca.setRule(birth, survive);
+        int n;
+        while ((n = next.fetch_add(1)) < total) {
+            Run &r = results[n];
+            const Task &task = tasks[n / runs];
+            r.task = n / runs;
+            r.index = n % runs;
+            r.seed = splitmix64Seed(seed, n);
+            ca.resetWorldSize(task.size, task.size);
+            fill(ca, task.density, r.seed);
+            evolve(ca, maxGenerations, r);
+            if (done) {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                done(r);
+            }
+        }
+    });
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return results;
+}
+
+
+inline void CAensemble::fill(CAbase &ca, double density, uint64_t seed) {
+    // every cell is alive with probability density (see CArandom.h), one row of words at a time
+    std::vector<uint64_t> row(ca.getRowWords());
+    for (int y = 1; y <= ca.getNy(); y++) {
+        for (size_t w = 0; w < row.size(); w++) {
+            uint64_t v = 0;
+            for (int b = 0; b < 64; b++)
+                v |= (uint64_t) splitmix64Chance(seed, density) << b;
+            row[w] = v;
+        }
+        ca.setRowBits(y, &row[0]);
+    }
+    ca.forgetHistory();
+}
+
+
+inline void CAensemble::evolve(CAbase &ca, uint64_t maxGenerations, Run &r) {
+    // until the universe is constant or has entered a cycle
+    r.peakPopulation = ca.getPopulation();
+    r.peakGeneration = 0;
+    r.stable = false;
+    r.stableGeneration = 0;
+    r.period = 0;
+    uint64_t g = 0;
+    while (g < maxGenerations) {
+        ca.worldEvolutionLife();
+        g++;
+        uint64_t population = ca.getPopulation();
+        if (population > r.peakPopulation) {
+            r.peakPopulation = population;
+            r.peakGeneration = g;
+        }
+        if (ca.isNotChanged()) {
+            // the generation before was the first one of the constant universe
+            r.stable = true;
+            r.stableGeneration = g - 1;
+            r.period = 1;
+            break;
+        }
+        if (ca.getPeriod() > 0) {
+            r.stable = true;
+            r.stableGeneration = ca.getCycleStart();
+            r.period = ca.getPeriod();
+            break;
+        }
+    }
+    r.generations = g;
+    r.population = ca.getPopulation();
+}
+
+
+#endif // CAENSEMBLE_H
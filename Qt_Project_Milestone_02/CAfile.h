@@ -0,0 +1,423 @@
+#ifndef CAFILE_H
+#define CAFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "CAbase.h"
+#include "CArule.h"
+
+
+class CAfile {
+    // Save formats of the universe. No Qt, so batch.cpp can use them as well.
+    //
+    // Binary format (*.ca), all numbers little endian:
+    //   "CAGL", uint16 version, uint8 encoding, uint8 0,
+    //   int32 nx, ny, universe mode, cell mode, uint32 color 0xRRGGBB, int32 interval,
+    //   uint16 birth, uint16 survive (rule masks, see CArule; since version 2),
+    //   followed by the living cells (value 1) in one of two encodings:
+    //   ENCODING_BITS  every row as getRowWords() uint64 words, cell x in bit x - 1
+    //   ENCODING_RUNS  all nx * ny cells row by row as alternating runs of dead and
+    //                  living cells, starting with dead ones; every run is a LEB128 varint
+    // save() writes the smaller one, load() streams the rows straight into CAbase.
+    //
+    // Life RLE (*.rle) is the usual pattern format: "x = 3, y = 3, rule = B3/S23"
+    // (the rule of ca is written, the one read is left to the caller), then runs of b (dead) and o (alive), $ at the end of a row and ! at the end.
+
+public:
+    struct Header {
+        Header() :
+            nx(0),
+            ny(0),
+            universeMode(0),
+            cellMode(0),
+            color(0),
+            interval(300),
+            birth(CAbase::RULE_LIFE_BIRTH),
+            survive(CAbase::RULE_LIFE_SURVIVE)
+            {}
+
+        int nx;
+        int ny;
+        int universeMode;
+        int cellMode;
+        uint32_t color; // 0xRRGGBB
+        int interval;
+        unsigned birth;
+        unsigned survive;
+    };
+
+    enum { VERSION = 2, ENCODING_BITS = 0, ENCODING_RUNS = 1 };
+    enum { MAX_SIZE = 1 << 15 }; // largest nx, ny (or RLE width, height) the readers accept
+    enum { MAX_RUN = 1 << 24 }; // largest run count of an RLE pattern
+
+    static bool save(std::ostream &out, CAbase &ca, const Header &header);
+    static bool readHeader(std::istream &in, Header &header, int &encoding);
+    static bool load(std::istream &in, CAbase &ca, Header &header); // resizes ca to the saved universe
+
+    static bool saveRLE(std::ostream &out, CAbase &ca); // bounding box of the living cells
+    static bool readRLEHeader(std::istream &in, int &width, int &height, std::string *rule = 0);
+    static bool loadRLE(std::istream &in, CAbase &ca); // clears ca and centres the pattern in it
+
+    // little endian numbers and varints, also used by CArecorder
+    static void put16(std::ostream &out, uint32_t v);
+    static void put32(std::ostream &out, uint32_t v);
+    static void put64(std::ostream &out, uint64_t v);
+    static uint32_t get32(std::istream &in);
+    static uint64_t get64(std::istream &in);
+    static void putVarint(std::vector<uint8_t> &buf, uint64_t v);
+    static bool getVarint(std::istream &in, uint64_t &v);
+
+private:
+    static void setBits(std::vector<uint64_t> &row, int x, int n);
+    static void putToken(std::ostream &out, std::string &line, int count, char tag);
+};
+
+
+inline void CAfile::put16(std::ostream &out, uint32_t v) {
+    out.put((char) (v & 0xFF));
+    out.put((char) ((v >> 8) & 0xFF));
+}
+
+
+inline void CAfile::put32(std::ostream &out, uint32_t v) {
+    put16(out, v & 0xFFFF);
+    put16(out, v >> 16);
+}
+
+
+inline void CAfile::put64(std::ostream &out, uint64_t v) {
+    put32(out, (uint32_t) v);
+    put32(out, (uint32_t) (v >> 32));
+}
+
+
+inline uint32_t CAfile::get32(std::istream &in) {
+    unsigned char b[4] = {0, 0, 0, 0};
+    in.read((char *) b, 4);
+    return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t) b[3] << 24);
+}
+
+
+inline uint64_t CAfile::get64(std::istream &in) {
+    uint64_t lo = get32(in);
+    return lo | ((uint64_t) get32(in) << 32);
+}
+
+
+inline void CAfile::putVarint(std::vector<uint8_t> &buf, uint64_t v) {
+    // 7 bits per byte, the high bit is set on all but the last byte
+    while (v >= 0x80) {
+        buf.push_back((uint8_t) (v | 0x80));
+        v >>= 7;
+    }
+    buf.push_back((uint8_t) v);
+}
+
+
+inline bool CAfile::getVarint(std::istream &in, uint64_t &v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = in.get();
+        if (c == EOF) return false;
+        v |= (uint64_t) (c & 0x7F) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+
+inline void CAfile::setBits(std::vector<uint64_t> &row, int x, int n) {
+    // set n bits starting at bit x
+    while (n > 0) {
+        int b = x & 63;
+        int m = std::min(n, 64 - b);
+        uint64_t mask = (m == 64) ? ~uint64_t(0) : ((uint64_t(1) << m) - 1);
+        row[x >> 6] |= mask << b;
+        x += m;
+        n -= m;
+    }
+}
+
+
+inline bool CAfile::save(std::ostream &out, CAbase &ca, const Header &header) {
+    // binary format, run-length encoded unless the runs get bigger than the plain bits
+    const int nx = ca.getNx(), ny = ca.getNy(), n = ca.getRowWords();
+    const size_t bitsSize = (size_t) ny * n * 8;
+    std::vector<uint64_t> row(n);
+
+    std::vector<uint8_t> runs;
+    uint64_t run = 0;
+    int cur = 0;
+    bool useRuns = true;
+    for (int y = 1; y <= ny && useRuns; y++) {
+        ca.getRowBits(y, &row[0]);
+        for (int w = 0; w < n; w++) {
+            const int cells = std::min(64, nx - w * 64);
+            int b = 0;
+            while (b < cells) {
+                // next cell of the other kind in this word
+                uint64_t t = (cur ? ~row[w] : row[w]) >> b;
+                if (cells - b < 64) t &= (uint64_t(1) << (cells - b)) - 1;
+                if (!t) {
+                    run += cells - b;
+                    break;
+                }
+                int z = __builtin_ctzll(t);
+                run += z;
+                b += z;
+                putVarint(runs, run);
+                run = 0;
+                cur ^= 1;
+            }
+        }
+        if (runs.size() > bitsSize) useRuns = false;
+    }
+    if (useRuns) putVarint(runs, run);
+
+    out.write("CAGL", 4);
+    put16(out, VERSION);
+    out.put((char) (useRuns ? ENCODING_RUNS : ENCODING_BITS));
+    out.put(0);
+    put32(out, nx);
+    put32(out, ny);
+    put32(out, header.universeMode);
+    put32(out, header.cellMode);
+    put32(out, header.color & 0xFFFFFF);
+    put32(out, header.interval);
+    put16(out, header.birth);
+    put16(out, header.survive);
+
+    if (useRuns) {
+        out.write((const char *) &runs[0], runs.size());
+    }
+    else {
+        std::vector<uint8_t> bytes(n * 8);
+        for (int y = 1; y <= ny; y++) {
+            ca.getRowBits(y, &row[0]);
+            for (int i = 0; i < n * 8; i++)
+                bytes[i] = (uint8_t) (row[i >> 3] >> ((i & 7) * 8));
+            out.write((const char *) &bytes[0], bytes.size());
+        }
+    }
+    return out.good();
+}
+
+
+inline bool CAfile::readHeader(std::istream &in, Header &header, int &encoding) {
+    char magic[4];
+    if (!in.read(magic, 4) || std::string(magic, 4) != "CAGL")
+        return false;
+    int version = in.get();
+    version |= in.get() << 8;
+    encoding = in.get();
+    in.get();
+    header.nx = (int) get32(in);
+    header.ny = (int) get32(in);
+    header.universeMode = (int) get32(in);
+    header.cellMode = (int) get32(in);
+    header.color = get32(in);
+    header.interval = (int) get32(in);
+    header.birth = CAbase::RULE_LIFE_BIRTH;
+    header.survive = CAbase::RULE_LIFE_SURVIVE;
+    if (version >= 2) {
+        header.birth = in.get();
+        header.birth |= in.get() << 8;
+        header.survive = in.get();
+        header.survive |= in.get() << 8;
+    }
+    return in.good() && version >= 1 && version <= VERSION
+           && (encoding == ENCODING_BITS || encoding == ENCODING_RUNS)
+           && header.nx > 0 && header.ny > 0 && header.nx <= MAX_SIZE && header.ny <= MAX_SIZE;
+}
+
+
+inline bool CAfile::load(std::istream &in, CAbase &ca, Header &header) {
+    // streams one row at a time into ca, there is never more than a row in memory
+    int encoding;
+    if (!readHeader(in, header, encoding))
+        return false;
+
+    ca.resetWorldSize(header.nx, header.ny);
+    const int nx = header.nx, n = ca.getRowWords();
+    std::vector<uint64_t> row(n, 0);
+
+    if (encoding == ENCODING_BITS) {
+        std::vector<uint8_t> bytes(n * 8);
+        for (int y = 1; y <= header.ny; y++) {
+            if (!in.read((char *) &bytes[0], bytes.size()))
+                return false;
+            std::fill(row.begin(), row.end(), 0);
+            for (int i = 0; i < n * 8; i++)
+                row[i >> 3] |= (uint64_t) bytes[i] << ((i & 7) * 8);
+            ca.setRowBits(y, &row[0]);
+        }
+        return true;
+    }
+
+    const uint64_t total = (uint64_t) nx * header.ny;
+    uint64_t done = 0;
+    int x = 0, y = 1, cur = 0;
+    while (done < total) {
+        uint64_t run;
+        if (!getVarint(in, run) || run > total - done)
+            return false;
+        done += run;
+        while (run > 0) {
+            int k = (int) std::min<uint64_t>(run, nx - x);
+            if (cur) setBits(row, x, k);
+            x += k;
+            run -= k;
+            if (x == nx) {
+                ca.setRowBits(y++, &row[0]);
+                std::fill(row.begin(), row.end(), 0);
+                x = 0;
+            }
+        }
+        cur ^= 1;
+    }
+    return true;
+}
+
+
+inline void CAfile::putToken(std::ostream &out, std::string &line, int count, char tag) {
+    // RLE lines must not be longer than 70 characters
+    std::string token = (count > 1 ? std::to_string(count) : std::string()) + tag;
+    if (line.size() + token.size() > 70) {
+        out << line << "\n";
+        line.clear();
+    }
+    line += token;
+}
+
+
+inline bool CAfile::saveRLE(std::ostream &out, CAbase &ca) {
+    // only the bounding box of the living cells is written
+    const int nx = ca.getNx(), ny = ca.getNy(), n = ca.getRowWords();
+    std::vector<uint64_t> row(n);
+    int x0 = nx, x1 = -1, y0 = ny, y1 = -1;
+    for (int y = 1; y <= ny; y++) {
+        ca.getRowBits(y, &row[0]);
+        for (int w = 0; w < n; w++) {
+            if (!row[w]) continue;
+            x0 = std::min(x0, w * 64 + __builtin_ctzll(row[w]));
+            x1 = std::max(x1, w * 64 + 63 - __builtin_clzll(row[w]));
+            y0 = std::min(y0, y - 1);
+            y1 = y - 1;
+        }
+    }
+    if (x1 < 0) {
+        out << "x = 0, y = 0, rule = " << CArule::format(ca.getBirth(), ca.getSurvive()) << "\n!\n";
+        return out.good();
+    }
+
+    out << "x = " << x1 - x0 + 1 << ", y = " << y1 - y0 + 1
+        << ", rule = " << CArule::format(ca.getBirth(), ca.getSurvive()) << "\n";
+    std::string line;
+    int rows = 0; // end of rows not written yet
+    for (int y = y0; y <= y1; y++) {
+        ca.getRowBits(y + 1, &row[0]);
+        int x = x0;
+        while (x <= x1) {
+            int v = (row[x >> 6] >> (x & 63)) & 1;
+            int end = x;
+            while (end <= x1 && (int) ((row[end >> 6] >> (end & 63)) & 1) == v)
+                end++;
+            if (v) {
+                if (rows) putToken(out, line, rows, '$');
+                rows = 0;
+                putToken(out, line, end - x, 'o');
+            }
+            else if (end <= x1) {
+                if (rows) putToken(out, line, rows, '$');
+                rows = 0;
+                putToken(out, line, end - x, 'b');
+            }
+            x = end;
+        }
+        rows++;
+    }
+    putToken(out, line, 1, '!');
+    out << line << "\n";
+    return out.good();
+}
+
+
+inline bool CAfile::readRLEHeader(std::istream &in, int &width, int &height, std::string *rule) {
+    // skips the # comment lines and reads the size from "x = .., y = ..", and the rule
+    // from "rule = .." if asked for (empty without one)
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        if (rule) {
+            size_t r = line.find("rule");
+            size_t eq = line.find('=', r);
+            rule->clear();
+            if (r != std::string::npos && eq != std::string::npos) {
+                *rule = line.substr(eq + 1);
+                rule->erase(0, rule->find_first_not_of(" \t"));
+                rule->erase(rule->find_last_not_of(" \t\r") + 1);
+            }
+        }
+        return sscanf(line.c_str(), " x = %d , y = %d", &width, &height) == 2
+               && width >= 0 && height >= 0 && width <= MAX_SIZE && height <= MAX_SIZE;
+    }
+    return false;
+}
+
+
+inline bool CAfile::loadRLE(std::istream &in, CAbase &ca) {
+    // dead cells are b (or .), living cells o (or a state A..X of multi-state patterns);
+    // cells that do not fit into ca are dropped, a run longer than MAX_RUN fails the load
+    int width, height;
+    if (!readRLEHeader(in, width, height))
+        return false;
+
+    ca.resetWorldSize(ca.getNx(), ca.getNy());
+    const int x0 = (ca.getNx() - width) / 2, y0 = (ca.getNy() - height) / 2;
+    int64_t x = 0, y = 0;
+    int count = 0;
+    int c;
+    while ((c = in.get()) != EOF && c != '!') {
+        if (c >= '0' && c <= '9') {
+            count = count * 10 + (c - '0');
+            if (count > MAX_RUN)
+                return false;
+            continue;
+        }
+        int k = count ? count : 1;
+        if (c == 'b' || c == '.') {
+            x += k;
+        }
+        else if (c == 'o' || (c >= 'A' && c <= 'X')) {
+            // only the part of the run on the field: cells x0 + x + i + 1 in 1 .. Nx
+            const int64_t cy = y0 + y + 1;
+            if (cy >= 1 && cy <= ca.getNy()) {
+                int64_t i0 = std::max<int64_t>(-x0 - x, 0), i1 = std::min<int64_t>(ca.getNx() - x0 - x, k);
+                for (int64_t i = i0; i < i1; i++)
+                    ca.setAlive((int) (x0 + x + i + 1), (int) cy, 1);
+            }
+            x += k;
+        }
+        else if (c == '$') {
+            y += k;
+            x = 0;
+        }
+        else if (c == '#') {
+            std::string comment;
+            std::getline(in, comment);
+        }
+        else {
+            continue; // line breaks and other characters do not end a count
+        }
+        count = 0;
+    }
+    return c == '!';
+}
+
+
+#endif // CAFILE_H
@@ -0,0 +1,415 @@
+#ifndef CAHASHLIFE_H
+#define CAHASHLIFE_H
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include "CAbase.h"
+
+
+// HashLife for the Classic Game of Life.
+//
+// The universe is a quadtree whose nodes are hash-consed: every distinct square of cells
+// exists only once, so repeating and empty regions cost nothing. Every node of level k
+// (2^k x 2^k cells) memoises its centre square of level k - 1 advanced by 2^min(j, k - 2)
+// generations, which lets step(j) jump 2^j generations at once.
+//
+// The HashLife universe is unbounded, not a torus: importWorld() copies the cells of a
+// CAbase universe, exportWorld() copies back the cells that are inside of it. The result
+// equals the one of worldEvolutionLife() as long as the pattern does not reach the border.
+
+class CAhashlife {
+
+public:
+    CAhashlife() :
+        generation(0),
+        maxNodes(4000000),
+        limit(4000000)
+        { clear(); }
+
+    void clear();
+
+    void importWorld(CAbase &ca);
+    void exportWorld(CAbase &ca);
+
+    void setCell(int64_t x, int64_t y, bool alive);
+    bool getCell(int64_t x, int64_t y);
+
+    void step(int j); // advance 2^j generations
+    void run(uint64_t n); // advance n generations
+
+    uint64_t getGeneration() {
+        return generation;
+    }
+
+    uint64_t getPopulation() {
+        return nodes[root].pop;
+    }
+
+    size_t getNodes() {
+        return nodes.size();
+    }
+
+    size_t getMaxNodes() {
+        return maxNodes;
+    }
+
+    void setMaxNodes(size_t n) {
+        // cap of the nodes: a step that reaches it collects the garbage and is done in two halves
+        maxNodes = n;
+    }
+
+    void collectGarbage();
+
+private:
+    struct Node {
+        int nw, ne, sw, se; // children, leaves (level 0) have none
+        int level;
+        uint64_t pop;
+        int result; // memoised centre after 2^resultLog generations, -1 if none
+        int resultLog;
+    };
+
+    struct Key {
+        int nw, ne, sw, se;
+        bool operator==(const Key &k) const {
+            return nw == k.nw && ne == k.ne && sw == k.sw && se == k.se;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &k) const {
+            uint64_t h = (uint64_t) k.nw * 0x9E3779B97F4A7C15ULL;
+            h = (h ^ (uint64_t) k.ne) * 0xC2B2AE3D27D4EB4FULL;
+            h = (h ^ (uint64_t) k.sw) * 0x165667B19E3779F9ULL;
+            h = (h ^ (uint64_t) k.se) * 0x9E3779B97F4A7C15ULL;
+            return (size_t) (h ^ (h >> 29));
+        }
+    };
+
+    int join(int nw, int ne, int sw, int se);
+    int empty(int level);
+    int expand(int n);
+    int center(int n);
+    bool isCentered(int n);
+    int result(int n, int j); // -1 if the nodes reached limit
+    int lifeBase(int n);
+    int build(CAbase &ca, int level, int x0, int y0);
+    void collect(int n, int64_t x0, int64_t y0, CAbase &ca);
+    int setCell(int n, int64_t x, int64_t y, bool alive);
+    int mark(int n, std::vector<int> &map, std::vector<Node> &kept);
+
+    std::vector<Node> nodes; // 0 = dead leaf, 1 = living leaf
+    std::unordered_map<Key, int, KeyHash> table;
+    std::vector<int> empties; // empty node of every level
+    int root; // centred at (0, 0): covers -2^(level-1) .. 2^(level-1) - 1
+    uint64_t generation;
+    size_t maxNodes;
+    size_t limit; // nodes at which result() gives up, maxNodes but for a single generation
+};
+
+
+inline void CAhashlife::clear() {
+    // empty universe of level 3
+    nodes.clear();
+    table.clear();
+    empties.clear();
+    Node leaf = {-1, -1, -1, -1, 0, 0, -1, 0};
+    nodes.push_back(leaf);
+    leaf.pop = 1;
+    nodes.push_back(leaf);
+    empties.push_back(0);
+    root = empty(3);
+    generation = 0;
+}
+
+
+inline int CAhashlife::join(int nw, int ne, int sw, int se) {
+    // the unique node with these four children
+    Key k = {nw, ne, sw, se};
+    std::unordered_map<Key, int, KeyHash>::iterator it = table.find(k);
+    if (it != table.end()) return it->second;
+
+    Node n = {nw, ne, sw, se, nodes[nw].level + 1,
+              nodes[nw].pop + nodes[ne].pop + nodes[sw].pop + nodes[se].pop, -1, 0};
+    nodes.push_back(n);
+    table[k] = (int) nodes.size() - 1;
+    return (int) nodes.size() - 1;
+}
+
+
+inline int CAhashlife::empty(int level) {
+    while ((int) empties.size() <= level) {
+        int e = empties.back();
+        empties.push_back(join(e, e, e, e));
+    }
+    return empties[level];
+}
+
+
+inline int CAhashlife::expand(int n) {
+    // same cells in a node of the next level, the old node is in the centre
+    Node c = nodes[n];
+    int e = empty(c.level - 1);
+    int nw = join(e, e, e, c.nw);
+    int ne = join(e, e, c.ne, e);
+    int sw = join(e, c.sw, e, e);
+    int se = join(c.se, e, e, e);
+    return join(nw, ne, sw, se);
+}
+
+
+inline int CAhashlife::center(int n) {
+    // centre square of the next lower level
+    Node c = nodes[n];
+    return join(nodes[c.nw].se, nodes[c.ne].sw, nodes[c.sw].ne, nodes[c.se].nw);
+}
+
+
+inline bool CAhashlife::isCentered(int n) {
+    // true if all living cells are inside of the centre square
+    Node c = nodes[n];
+    const Node &nw = nodes[c.nw], &ne = nodes[c.ne], &sw = nodes[c.sw], &se = nodes[c.se];
+    uint64_t inner = nodes[nw.se].pop + nodes[ne.sw].pop + nodes[sw.ne].pop + nodes[se.nw].pop;
+    return inner == c.pop;
+}
+
+
+inline int CAhashlife::lifeBase(int n) {
+    // level 2 node (4 x 4 cells): centre 2 x 2 cells after one generation
+    Node c = nodes[n];
+    int q[4] = {c.nw, c.ne, c.sw, c.se};
+    int cell[4][4];
+    for (int i = 0; i < 4; i++) {
+        const Node &s = nodes[q[i]];
+        int ox = (i & 1) * 2, oy = (i >> 1) * 2;
+        cell[oy][ox] = s.nw;
+        cell[oy][ox + 1] = s.ne;
+        cell[oy + 1][ox] = s.sw;
+        cell[oy + 1][ox + 1] = s.se;
+    }
+
+    int out[4];
+    for (int i = 0; i < 4; i++) {
+        int x = 1 + (i & 1), y = 1 + (i >> 1);
+        int n_sum = 0;
+        for (int iy = -1; iy <= 1; iy++)
+            for (int ix = -1; ix <= 1; ix++)
+                if (ix || iy) n_sum += cell[y + iy][x + ix];
+        out[i] = (n_sum == 3 || (n_sum == 2 && cell[y][x])) ? 1 : 0;
+    }
+    return join(out[0], out[1], out[2], out[3]);
+}
+
+
+inline int CAhashlife::result(int n, int j) {
+    // centre of node n (level k) after 2^min(j, k - 2) generations
+    Node c = nodes[n];
+    if (c.pop == 0) return empty(c.level - 1);
+    int e = (j < c.level - 2) ? j : c.level - 2;
+    if (c.result >= 0 && c.resultLog == e) return c.result;
+    if (nodes.size() > limit) return -1;
+
+    int r;
+    if (c.level == 2) {
+        r = lifeBase(n);
+    }
+    else {
+        Node nw = nodes[c.nw], ne = nodes[c.ne], sw = nodes[c.sw], se = nodes[c.se];
+        // nine overlapping nodes of level k - 1
+        int a[9] = {c.nw,
+                    join(nw.ne, ne.nw, nw.se, ne.sw),
+                    c.ne,
+                    join(nw.sw, nw.se, sw.nw, sw.ne),
+                    join(nw.se, ne.sw, sw.ne, se.nw),
+                    join(ne.sw, ne.se, se.nw, se.ne),
+                    c.sw,
+                    join(sw.ne, se.nw, sw.se, se.sw),
+                    c.se};
+
+        // full speed: both halves advance 2^(k - 3); otherwise only the second half advances
+        int b[9];
+        for (int i = 0; i < 9; i++)
+            if ((b[i] = (e == c.level - 2) ? result(a[i], j) : center(a[i])) < 0) return -1;
+
+        int r00 = result(join(b[0], b[1], b[3], b[4]), j);
+        if (r00 < 0) return -1;
+        int r01 = result(join(b[1], b[2], b[4], b[5]), j);
+        if (r01 < 0) return -1;
+        int r10 = result(join(b[3], b[4], b[6], b[7]), j);
+        if (r10 < 0) return -1;
+        int r11 = result(join(b[4], b[5], b[7], b[8]), j);
+        if (r11 < 0) return -1;
+        r = join(r00, r01, r10, r11);
+    }
+
+    nodes[n].result = r;
+    nodes[n].resultLog = e;
+    return r;
+}
+
+
+inline void CAhashlife::step(int j) {
+    // advance 2^j generations; the root grows until the pattern cannot leave it in that time
+    if (nodes.size() > maxNodes) collectGarbage();
+
+    while (nodes[root].level < j + 2 || !isCentered(root))
+        root = expand(root);
+    root = expand(root);
+    limit = j > 0 ? maxNodes : (size_t) -1; // one generation must be possible, whatever it needs
+    int r = result(root, j);
+    if (r < 0) {
+        // too many nodes: keep only the universe, without the levels added for this step,
+        // and try two steps of half the size
+        collectGarbage();
+        while (nodes[root].level > 3 && isCentered(root))
+            root = center(root);
+        step(j - 1);
+        step(j - 1);
+        return;
+    }
+    root = r;
+    generation += uint64_t(1) << j;
+}
+
+
+inline void CAhashlife::run(uint64_t n) {
+    // advance n generations as a sum of powers of two
+    for (int j = 0; n; j++, n >>= 1)
+        if (n & 1) step(j);
+}
+
+
+inline int CAhashlife::setCell(int n, int64_t x, int64_t y, bool alive) {
+    // node n with cell x, y (relative to its upper left corner) changed
+    Node c = nodes[n];
+    if (c.level == 0) return alive ? 1 : 0;
+    int64_t half = int64_t(1) << (c.level - 1);
+    if (y < half) {
+        if (x < half) return join(setCell(c.nw, x, y, alive), c.ne, c.sw, c.se);
+        return join(c.nw, setCell(c.ne, x - half, y, alive), c.sw, c.se);
+    }
+    if (x < half) return join(c.nw, c.ne, setCell(c.sw, x, y - half, alive), c.se);
+    return join(c.nw, c.ne, c.sw, setCell(c.se, x - half, y - half, alive));
+}
+
+
+inline void CAhashlife::setCell(int64_t x, int64_t y, bool alive) {
+    // set cell x, y of the unbounded universe
+    for (;;) {
+        int64_t half = int64_t(1) << (nodes[root].level - 1);
+        if (x >= -half && x < half && y >= -half && y < half) break;
+        root = expand(root);
+    }
+    int64_t half = int64_t(1) << (nodes[root].level - 1);
+    root = setCell(root, x + half, y + half, alive);
+}
+
+
+inline bool CAhashlife::getCell(int64_t x, int64_t y) {
+    int n = root;
+    int64_t half = int64_t(1) << (nodes[root].level - 1);
+    if (x < -half || x >= half || y < -half || y >= half) return false;
+    x += half;
+    y += half;
+    while (nodes[n].level > 0) {
+        if (nodes[n].pop == 0) return false;
+        half = int64_t(1) << (nodes[n].level - 1);
+        bool east = x >= half, south = y >= half;
+        n = south ? (east ? nodes[n].se : nodes[n].sw) : (east ? nodes[n].ne : nodes[n].nw);
+        if (east) x -= half;
+        if (south) y -= half;
+    }
+    return n == 1;
+}
+
+
+inline int CAhashlife::build(CAbase &ca, int level, int x0, int y0) {
+    // node of the given level with the cells of ca starting at cell x0, y0 (0 based)
+    if (x0 >= ca.getNx() || y0 >= ca.getNy()) return empty(level);
+    if (level == 0) return ca.isAlive(x0 + 1, y0 + 1) == 1 ? 1 : 0;
+    int half = 1 << (level - 1);
+    return join(build(ca, level - 1, x0, y0),
+                build(ca, level - 1, x0 + half, y0),
+                build(ca, level - 1, x0, y0 + half),
+                build(ca, level - 1, x0 + half, y0 + half));
+}
+
+
+inline void CAhashlife::importWorld(CAbase &ca) {
+    // the cells of ca become the quadrant x, y >= 0 of an empty universe
+    clear();
+    int level = 1;
+    while ((1 << level) < ca.getNx() || (1 << level) < ca.getNy()) level++;
+    int n = build(ca, level, 0, 0);
+    int e = empty(level);
+    root = join(e, e, e, n);
+}
+
+
+inline void CAhashlife::collect(int n, int64_t x0, int64_t y0, CAbase &ca) {
+    // write the living cells of node n with upper left corner x0, y0 into ca
+    const Node &c = nodes[n];
+    if (c.pop == 0) return;
+    int64_t size = int64_t(1) << c.level;
+    if (x0 >= ca.getNx() || y0 >= ca.getNy() || x0 + size <= 0 || y0 + size <= 0) return;
+    if (c.level == 0) {
+        ca.setAlive((int) x0 + 1, (int) y0 + 1, 1);
+        return;
+    }
+    int64_t half = size / 2;
+    collect(c.nw, x0, y0, ca);
+    collect(c.ne, x0 + half, y0, ca);
+    collect(c.sw, x0, y0 + half, ca);
+    collect(c.se, x0 + half, y0 + half, ca);
+}
+
+
+inline void CAhashlife::exportWorld(CAbase &ca) {
+    // copy the cells at 0 .. Nx - 1, 0 .. Ny - 1 back into ca, cells outside of it are lost
+    for (int iy = 1; iy <= ca.getNy(); iy++)
+        for (int ix = 1; ix <= ca.getNx(); ix++)
+            ca.setAlive(ix, iy, 0);
+    int64_t half = int64_t(1) << (nodes[root].level - 1);
+    collect(root, -half, -half, ca);
+}
+
+
+inline int CAhashlife::mark(int n, std::vector<int> &map, std::vector<Node> &kept) {
+    // copy node n and its children into kept, returns the new index
+    if (map[n] >= 0) return map[n];
+    Node c = nodes[n];
+    if (c.level > 0) {
+        c.nw = mark(c.nw, map, kept);
+        c.ne = mark(c.ne, map, kept);
+        c.sw = mark(c.sw, map, kept);
+        c.se = mark(c.se, map, kept);
+    }
+    c.result = -1;
+    kept.push_back(c);
+    map[n] = (int) kept.size() - 1;
+    return map[n];
+}
+
+
+inline void CAhashlife::collectGarbage() {
+    // keep only the nodes reachable from the root; memoised results are dropped
+    std::vector<int> map(nodes.size(), -1);
+    std::vector<Node> kept;
+    map[0] = 0;
+    map[1] = 1;
+    kept.push_back(nodes[0]);
+    kept.push_back(nodes[1]);
+    root = mark(root, map, kept);
+
+    nodes.swap(kept);
+    table.clear();
+    for (size_t i = 2; i < nodes.size(); i++) {
+        Key k = {nodes[i].nw, nodes[i].ne, nodes[i].sw, nodes[i].se};
+        table[k] = (int) i;
+    }
+    empties.resize(1);
+}
+
+
+#endif // CAHASHLIFE_H
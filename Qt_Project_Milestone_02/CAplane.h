@@ -0,0 +1,109 @@
+#ifndef CAPLANE_H
+#define CAPLANE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+
+
+template <class T>
+class CAplane {
+    // One plane of cells for CAbase: cells x = 0 .. nx + 1, y = 0 .. ny + 1, the outermost
+    // ones being the border. Every row starts on a 64 byte boundary and is padded to a
+    // multiple of 64 bytes, so row kernels can use aligned vectors. The memory is only
+    // allocated by the first reset() and kept when the plane is reset to the same or a
+    // smaller size, so clearing the universe does not allocate.
+
+public:
+    CAplane() :
+        raw(0),
+        data(0),
+        capacity(0),
+        stride(0)
+        {}
+
+    ~CAplane() {
+        free(raw);
+    }
+
+    void reset(int nx, int ny, T inside, T border); // size the plane and fill it
+    void release(); // give the memory back, the plane is empty then
+
+    bool isAllocated() {
+        return data != 0;
+    }
+
+    T *row(int y) {
+        return data + (size_t) y * stride;
+    }
+
+    T &at(int x, int y) {
+        return data[(size_t) y * stride + x];
+    }
+
+    int getStride() {
+        // cells from one row to the next
+        return stride;
+    }
+
+    size_t getBytes() {
+        // memory held by the plane
+        return raw ? capacity * sizeof(T) + 64 : 0;
+    }
+
+    void swap(CAplane &other) {
+        std::swap(raw, other.raw);
+        std::swap(data, other.data);
+        std::swap(capacity, other.capacity);
+        std::swap(stride, other.stride);
+    }
+
+private:
+    CAplane(const CAplane &);
+    CAplane &operator=(const CAplane &);
+
+    void *raw; // as allocated, data is raw aligned to 64 bytes
+    T *data;
+    size_t capacity; // cells
+    int stride;
+};
+
+
+template <class T>
+inline void CAplane<T>::reset(int nx, int ny, T inside, T border) {
+    const int perLine = 64 / sizeof(T);
+    stride = (nx + 2 + perLine - 1) / perLine * perLine;
+    const size_t size = (size_t) stride * (ny + 2);
+    if (size > capacity) {
+        free(raw);
+        raw = malloc(size * sizeof(T) + 64);
+        if (!raw) throw std::bad_alloc();
+        data = (T *) (((uintptr_t) raw + 63) & ~(uintptr_t) 63);
+        capacity = size;
+    }
+
+    // the cells of a row are inside, its first and last one and the first and last row border
+    std::fill(data, data + stride, border);
+    for (int y = 1; y <= ny; y++) {
+        T *r = row(y);
+        r[0] = border;
+        std::fill(r + 1, r + nx + 1, inside);
+        std::fill(r + nx + 1, r + stride, border);
+    }
+    std::fill(row(ny + 1), row(ny + 1) + stride, border);
+}
+
+
+template <class T>
+inline void CAplane<T>::release() {
+    free(raw);
+    raw = 0;
+    data = 0;
+    capacity = 0;
+    stride = 0;
+}
+
+
+#endif // CAPLANE_H
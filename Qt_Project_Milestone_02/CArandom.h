@@ -0,0 +1,36 @@
+#ifndef CARANDOM_H
+#define CARANDOM_H
+
+#include <stdint.h>
+
+
+// splitmix64: well mixed 64 bit numbers from a 64 bit state, the same on every platform, so
+// random universes, the food of the snake and the seeds of batch runs can be reproduced.
+// The mixing function alone also gives the Zobrist keys of CAbase.
+
+static const uint64_t SPLITMIX64_GAMMA = 0x9E3779B97F4A7C15ULL;
+
+inline uint64_t splitmix64Mix(uint64_t z) {
+    // the finalizer, a bijection in which every bit of z changes about half of the result
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+inline uint64_t splitmix64(uint64_t &state) {
+    // next number of the sequence of state
+    return splitmix64Mix(state += SPLITMIX64_GAMMA);
+}
+
+inline uint64_t splitmix64Seed(uint64_t seed, int n) {
+    // seed of run n of a series, e.g. one game of many, whatever the order of the runs
+    return splitmix64Mix(seed + (uint64_t) (n + 1) * SPLITMIX64_GAMMA);
+}
+
+inline bool splitmix64Chance(uint64_t &state, double p) {
+    // true with probability p: 53 random bits against p * 2^53, which is exact, so p = 1 is always true
+    return (splitmix64(state) >> 11) < p * 9007199254740992.0;
+}
+
+
+#endif // CARANDOM_H
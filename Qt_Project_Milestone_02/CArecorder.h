@@ -0,0 +1,335 @@
+#ifndef CARECORDER_H
+#define CARECORDER_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "CAbase.h"
+#include "CAdelta.h"
+#include "CAfile.h"
+
+
+// Trajectory file of a run, written by CArecorder and read by CAplayer. All numbers little endian.
+//
+// "CATR", uint16 version, uint16 0, then records of
+//   uint8 type, uint64 generation, uint32 payload bytes, payload
+//   KEYFRAME  the universe as CAfile binary save; after a jump (see CArecorder::skip) its
+//             generation is more than one after the record before
+//   DELTA     uint32 count, then the flipped cells (y - 1) * nx + x - 1 in ascending order,
+//             each as LEB128 varint of the distance to the previous one
+//   INDEX     uint32 count, then uint64 generation and uint64 file offset of every keyframe;
+//             its generation is the last one recorded
+// and at the end the uint64 offset of the INDEX record and "CATI". A file without them
+// (the recording was not closed) is indexed by scanning its records.
+
+
+class CArecorder {
+    // Appends every generation as delta (see CAdelta) to a trajectory file, with a keyframe
+    // every keyInterval generations. Recording costs O(changed tiles) and the file grows with
+    // the activity, not the area.
+
+public:
+    enum { VERSION = 1, KEYFRAME = 0, DELTA = 1, INDEX = 2 };
+
+    CArecorder() :
+        generation(0),
+        keyInterval(1000),
+        delta(CAbase::DIRTY_RECORD)
+        {}
+
+    ~CArecorder() {
+        close();
+    }
+
+    bool open(const std::string &filename, CAbase &ca, int keys = 1000); // keyframe of the current universe
+    void record(CAbase &ca); // after every generation, edits since the last call are included
+    void skip(uint64_t n, CAbase &ca); // after a jump n generations ahead, e.g. by HashLife
+    void close(); // writes the index
+
+    bool isOpen() {
+        return out.is_open();
+    }
+
+    uint64_t getGeneration() {
+        // generations recorded so far
+        return generation;
+    }
+
+private:
+    void keyframe(CAbase &ca);
+    void writeRecord(int type, const char *payload, size_t size);
+
+    std::ofstream out;
+    uint64_t generation;
+    int keyInterval;
+    CAdelta delta;
+    std::vector<uint8_t> bytes; // payload of the delta
+    std::vector<std::pair<uint64_t, uint64_t> > keys; // generation and file offset of the keyframes
+};
+
+
+class CAplayer {
+    // Seeks in a trajectory file: loads the nearest keyframe before the generation and
+    // applies the deltas up to it. Seeking forward from the current generation only applies
+    // the deltas in between.
+
+public:
+    CAplayer() :
+        generation(0),
+        last(0),
+        loaded(false),
+        position(0)
+        {}
+
+    bool open(const std::string &filename);
+
+    uint64_t getLastGeneration() {
+        return last;
+    }
+
+    uint64_t getGeneration() {
+        // generation in the universe after the last seek
+        return generation;
+    }
+
+    bool seek(uint64_t target, CAbase &ca); // a generation jumped over gives the one after the jump
+
+private:
+    enum { RECORD_HEADER = 13 }; // type, generation, payload bytes
+
+    bool readRecordHeader(int &type, uint64_t &gen, uint32_t &length);
+    bool applyDelta(CAbase &ca);
+    void scan();
+
+    std::ifstream in;
+    std::vector<std::pair<uint64_t, uint64_t> > keys;
+    uint64_t generation;
+    uint64_t last;
+    bool loaded; // the universe of the last seek holds generation
+    uint64_t position; // file offset of the record after generation
+};
+
+
+inline bool CArecorder::open(const std::string &filename, CAbase &ca, int keys) {
+    close();
+    out.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    out.write("CATR", 4);
+    CAfile::put16(out, VERSION);
+    CAfile::put16(out, 0);
+
+    generation = 0;
+    keyInterval = std::max(1, keys);
+    this->keys.clear();
+    keyframe(ca);
+    return out.good();
+}
+
+
+inline void CArecorder::record(CAbase &ca) {
+    if (!isOpen())
+        return;
+    generation++;
+    if (!delta.matches(ca)) {
+        // a new universe size can only be stored as keyframe
+        keyframe(ca);
+        return;
+    }
+
+    bytes.assign(4, 0); // count
+    uint32_t count = delta.take(ca, &bytes);
+    for (int b = 0; b < 4; b++)
+        bytes[b] = (uint8_t) (count >> (8 * b));
+    writeRecord(DELTA, (const char *) &bytes[0], bytes.size());
+
+    if (generation % keyInterval == 0)
+        keyframe(ca);
+}
+
+
+inline void CArecorder::skip(uint64_t n, CAbase &ca) {
+    // the generations in between were never computed, so there is no delta to them
+    if (!isOpen() || n == 0)
+        return;
+    generation += n;
+    keyframe(ca);
+}
+
+
+inline void CArecorder::close() {
+    if (!isOpen())
+        return;
+    uint64_t offset = (uint64_t) out.tellp();
+    std::ostringstream payload;
+    CAfile::put32(payload, (uint32_t) keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        CAfile::put64(payload, keys[i].first);
+        CAfile::put64(payload, keys[i].second);
+    }
+    std::string data = payload.str();
+    writeRecord(INDEX, data.data(), data.size());
+    CAfile::put64(out, offset);
+    out.write("CATI", 4);
+    out.close();
+}
+
+
+inline void CArecorder::keyframe(CAbase &ca) {
+    // full universe, the next delta starts from here
+    delta.reset(ca);
+
+    std::ostringstream payload;
+    CAfile::save(payload, ca, CAfile::Header());
+    keys.push_back(std::make_pair(generation, (uint64_t) out.tellp()));
+    std::string data = payload.str();
+    writeRecord(KEYFRAME, data.data(), data.size());
+}
+
+
+inline void CArecorder::writeRecord(int type, const char *payload, size_t size) {
+    out.put((char) type);
+    CAfile::put64(out, generation);
+    CAfile::put32(out, (uint32_t) size);
+    out.write(payload, size);
+}
+
+
+inline bool CAplayer::open(const std::string &filename) {
+    in.close();
+    in.clear();
+    in.open(filename.c_str(), std::ios::binary);
+    char magic[4];
+    if (!in.read(magic, 4) || std::string(magic, 4) != "CATR")
+        return false;
+    in.seekg(4, std::ios::cur); // version and reserved
+
+    keys.clear();
+    last = 0;
+    loaded = false;
+
+    // index at the end of the file, or scan the records if the recording was not closed
+    in.seekg(-12, std::ios::end);
+    uint64_t offset = CAfile::get64(in);
+    bool indexed = in.read(magic, 4) && std::string(magic, 4) == "CATI";
+    int type;
+    uint32_t length;
+    if (indexed) {
+        in.seekg(offset);
+        indexed = readRecordHeader(type, last, length) && type == CArecorder::INDEX;
+    }
+    if (indexed) {
+        uint32_t count = CAfile::get32(in);
+        for (uint32_t i = 0; i < count && in; i++) {
+            uint64_t gen = CAfile::get64(in);
+            keys.push_back(std::make_pair(gen, CAfile::get64(in)));
+        }
+        indexed = in.good();
+    }
+    if (!indexed)
+        scan();
+    return !keys.empty();
+}
+
+
+inline bool CAplayer::seek(uint64_t target, CAbase &ca) {
+    if (keys.empty() || target > last)
+        return false;
+
+    // nearest keyframe, unless the universe is already closer to the target
+    size_t k = 0;
+    while (k + 1 < keys.size() && keys[k + 1].first <= target)
+        k++;
+    if (!loaded || generation > target || generation < keys[k].first) {
+        in.clear();
+        in.seekg(keys[k].second);
+        int type;
+        uint64_t gen;
+        uint32_t length;
+        CAfile::Header header;
+        if (!readRecordHeader(type, gen, length) || type != CArecorder::KEYFRAME || !CAfile::load(in, ca, header))
+            return false;
+        generation = gen;
+        position = keys[k].second + RECORD_HEADER + length;
+        loaded = true;
+    }
+
+    while (generation < target) {
+        in.clear();
+        in.seekg(position);
+        int type;
+        uint64_t gen;
+        uint32_t length;
+        if (!readRecordHeader(type, gen, length) || type == CArecorder::INDEX)
+            return false;
+        position += RECORD_HEADER + length;
+        if (type == CArecorder::DELTA && gen == generation + 1) {
+            if (!applyDelta(ca))
+                return false;
+            generation = gen;
+        }
+        else if (type == CArecorder::KEYFRAME && gen > generation) {
+            // the universe size changed
+            CAfile::Header header;
+            if (!CAfile::load(in, ca, header))
+                return false;
+            generation = gen;
+        }
+    }
+    return true;
+}
+
+
+inline bool CAplayer::readRecordHeader(int &type, uint64_t &gen, uint32_t &length) {
+    type = in.get();
+    gen = CAfile::get64(in);
+    length = CAfile::get32(in);
+    return in.good();
+}
+
+
+inline bool CAplayer::applyDelta(CAbase &ca) {
+    const uint64_t nx = ca.getNx();
+    const uint64_t cells = nx * ca.getNy();
+    uint32_t count = CAfile::get32(in);
+    uint64_t cell = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t gap;
+        if (!CAfile::getVarint(in, gap))
+            return false;
+        cell += gap;
+        if (gap > cells || cell >= cells)
+            return false; // broken file, the cell is not in the universe
+        int x = (int) (cell % nx) + 1, y = (int) (cell / nx) + 1;
+        ca.setAlive(x, y, ca.isAlive(x, y) == 1 ? 0 : 1);
+    }
+    return true;
+}
+
+
+inline void CAplayer::scan() {
+    // index of a file without one: all complete records, up to the first broken one
+    in.clear();
+    in.seekg(0, std::ios::end);
+    const uint64_t size = (uint64_t) in.tellg();
+    uint64_t offset = 8;
+    while (offset + RECORD_HEADER <= size) {
+        in.clear();
+        in.seekg(offset);
+        int type;
+        uint64_t gen;
+        uint32_t length;
+        if (!readRecordHeader(type, gen, length) || offset + RECORD_HEADER + length > size || type == CArecorder::INDEX)
+            break;
+        if (type == CArecorder::KEYFRAME)
+            keys.push_back(std::make_pair(gen, offset));
+        last = gen;
+        offset += RECORD_HEADER + length;
+    }
+}
+
+
+#endif // CARECORDER_H
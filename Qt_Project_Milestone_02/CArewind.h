@@ -0,0 +1,207 @@
+#ifndef CAREWIND_H
+#define CAREWIND_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "CAbase.h"
+#include "CAdelta.h"
+#include "CAfile.h"
+
+
+class CArewind {
+    // Bounded in-memory history of the last generations for stepping back: the delta of
+    // every generation (see CAdelta) and a snapshot (CAfile binary save) every
+    // SNAPSHOT_INTERVAL generations, together at most budget bytes; the oldest generations
+    // are dropped first. Going to another buffered generation applies the deltas in between,
+    // O(changed cells), or starts from the nearest snapshot before it if that is cheaper.
+    // Continuing the game from an earlier generation drops the generations after it.
+
+public:
+    enum { SNAPSHOT_INTERVAL = 256 };
+
+    CArewind() :
+        delta(CAbase::DIRTY_REWIND),
+        budget(64 << 20),
+        used(0),
+        base(0),
+        current(0),
+        tracking(false)
+        {}
+
+    void setBudget(size_t bytes) {
+        // memory for the history, 0 switches it off
+        budget = bytes;
+        if (!budget) clear();
+        shrink();
+    }
+
+    size_t getBudget() {
+        return budget;
+    }
+
+    uint64_t getOldest() {
+        return base;
+    }
+
+    uint64_t getNewest() {
+        return steps.empty() ? base : steps.back().generation;
+    }
+
+    uint64_t getCurrent() {
+        return current;
+    }
+
+    void clear() {
+        steps.clear();
+        snapshots.clear();
+        used = 0;
+        base = 0;
+        current = 0;
+        tracking = false;
+    }
+
+    void begin(CAbase &ca); // before every generation, starts the history if needed
+    void capture(CAbase &ca); // after every generation
+    bool seek(uint64_t generation, CAbase &ca); // go to a buffered generation
+
+private:
+    struct Step {
+        uint64_t generation;
+        uint32_t count;
+        std::vector<uint8_t> bytes; // cells flipped from generation - 1 to generation
+    };
+
+    struct Snapshot {
+        uint64_t generation;
+        std::string data;
+    };
+
+    void snapshot(CAbase &ca);
+    void shrink();
+    bool applyStep(CAbase &ca, uint64_t generation);
+
+    CAdelta delta;
+    std::deque<Step> steps; // consecutive generations base + 1 .. getNewest()
+    std::deque<Snapshot> snapshots;
+    size_t budget;
+    size_t used; // bytes in steps and snapshots
+    uint64_t base; // oldest generation that can be reached
+    uint64_t current; // generation the universe is at
+    bool tracking;
+};
+
+
+inline void CArewind::begin(CAbase &ca) {
+    // a new history starts with a snapshot of the universe as generation 0
+    if (!budget || (tracking && delta.matches(ca)))
+        return;
+    clear();
+    delta.reset(ca);
+    snapshot(ca);
+    tracking = true;
+}
+
+
+inline void CArewind::capture(CAbase &ca) {
+    if (!tracking)
+        return;
+
+    // the game goes on from an earlier generation: forget the ones after it
+    while (!steps.empty() && steps.back().generation > current) {
+        used -= steps.back().bytes.size() + sizeof(Step);
+        steps.pop_back();
+    }
+    while (!snapshots.empty() && snapshots.back().generation > current) {
+        used -= snapshots.back().data.size() + sizeof(Snapshot);
+        snapshots.pop_back();
+    }
+
+    steps.push_back(Step());
+    Step &step = steps.back();
+    step.generation = ++current;
+    step.count = delta.take(ca, &step.bytes);
+    step.bytes.shrink_to_fit();
+    used += step.bytes.size() + sizeof(Step);
+
+    if (current % SNAPSHOT_INTERVAL == 0)
+        snapshot(ca);
+    shrink();
+}
+
+
+inline bool CArewind::seek(uint64_t generation, CAbase &ca) {
+    if (!tracking || generation < base || generation > getNewest() || !delta.matches(ca))
+        return false;
+
+    // edits since the last generation stay in the universe
+    delta.take(ca, 0);
+
+    // flips on the way from the current generation, and from the nearest snapshot
+    uint64_t lo = std::min(generation, current), hi = std::max(generation, current);
+    uint64_t cost = 0;
+    for (uint64_t g = lo + 1; g <= hi; g++)
+        cost += steps[g - base - 1].count;
+    const Snapshot *from = 0;
+    for (size_t i = 0; i < snapshots.size() && snapshots[i].generation <= generation; i++)
+        from = &snapshots[i];
+    if (from && from->generation >= base) {
+        uint64_t costFrom = (uint64_t) ca.getNx() * ca.getNy() / 16; // decoding the snapshot
+        for (uint64_t g = from->generation + 1; g <= generation; g++)
+            costFrom += steps[g - base - 1].count;
+        if (costFrom < cost) {
+            std::istringstream in(from->data);
+            CAfile::Header header;
+            if (!CAfile::load(in, ca, header))
+                return false;
+            delta.reset(ca);
+            current = from->generation;
+        }
+    }
+
+    // a delta undoes itself, so the same steps lead back and forth
+    for (; current > generation; current--)
+        if (!applyStep(ca, current))
+            return false;
+    for (; current < generation; current++)
+        if (!applyStep(ca, current + 1))
+            return false;
+    delta.take(ca, 0);
+    return true;
+}
+
+
+inline void CArewind::snapshot(CAbase &ca) {
+    std::ostringstream out;
+    CAfile::save(out, ca, CAfile::Header());
+    snapshots.push_back(Snapshot());
+    snapshots.back().generation = current;
+    snapshots.back().data = out.str();
+    used += snapshots.back().data.size() + sizeof(Snapshot);
+}
+
+
+inline void CArewind::shrink() {
+    // drop the oldest generations until the history fits into the budget
+    while (used > budget && !steps.empty() && steps.front().generation <= current) {
+        used -= steps.front().bytes.size() + sizeof(Step);
+        base = steps.front().generation;
+        steps.pop_front();
+    }
+    while (!snapshots.empty() && snapshots.front().generation < base) {
+        used -= snapshots.front().data.size() + sizeof(Snapshot);
+        snapshots.pop_front();
+    }
+}
+
+
+inline bool CArewind::applyStep(CAbase &ca, uint64_t generation) {
+    const Step &step = steps[generation - base - 1];
+    return !step.count || CAdelta::apply(ca, &step.bytes[0], step.count);
+}
+
+
+#endif // CAREWIND_H
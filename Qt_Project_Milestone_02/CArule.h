@@ -0,0 +1,73 @@
+#ifndef CARULE_H
+#define CARULE_H
+
+#include <ctype.h>
+#include <string>
+
+
+class CArule {
+    // Life-like rules as birth and survive masks: bit n is set if a cell is born / survives
+    // with n living neighbours. Rulestrings are written "B3/S23"; the older "23/3" (survival
+    // first) and lower case are read as well.
+
+public:
+    struct Preset {
+        const char *name;
+        const char *rule;
+    };
+
+    static const Preset *presets(int &count) {
+        // well known rules, all of them have compiled kernels (see CAsimd.h)
+        static const Preset list[] = {
+            {"Classic Life", "B3/S23"},
+            {"HighLife", "B36/S23"},
+            {"Seeds", "B2/S"},
+            {"Day & Night", "B3678/S34678"},
+            {"Life without Death", "B3/S012345678"},
+            {"Replicator", "B1357/S1357"},
+            {"Maze", "B3/S12345"},
+            {"Diamoeba", "B35678/S5678"},
+            {"2x2", "B36/S125"},
+            {"Morley", "B368/S245"},
+            {"Anneal", "B4678/S35678"}
+        };
+        count = sizeof(list) / sizeof(list[0]);
+        return list;
+    }
+
+    static bool parse(const std::string &text, unsigned &birth, unsigned &survive) {
+        // false if text is no rulestring, birth and survive are left unchanged then
+        const bool letters = text.find_first_of("BbSs") != std::string::npos;
+        unsigned masks[2] = {0, 0}; // birth, survive
+        int part = letters ? -1 : 1; // "23/3" starts with the survival
+        int slashes = 0;
+        for (size_t i = 0; i < text.size(); i++) {
+            char c = (char) toupper((unsigned char) text[i]);
+            if (c == ' ') continue;
+            if (letters && (c == 'B' || c == 'S')) part = (c == 'B') ? 0 : 1;
+            else if (c == '/') {
+                slashes++;
+                if (!letters) part = 0;
+            }
+            else if (c >= '0' && c <= '8' && part >= 0) masks[part] |= 1u << (c - '0');
+            else return false;
+        }
+        if (slashes != 1) return false;
+        birth = masks[0];
+        survive = masks[1];
+        return true;
+    }
+
+    static std::string format(unsigned birth, unsigned survive) {
+        std::string s = "B";
+        for (int n = 0; n <= 8; n++)
+            if ((birth >> n) & 1) s += (char) ('0' + n);
+        s += "/S";
+        for (int n = 0; n <= 8; n++)
+            if ((survive >> n) & 1) s += (char) ('0' + n);
+        return s;
+    }
+};
+
+
+#endif // CARULE_H
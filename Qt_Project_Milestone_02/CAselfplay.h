@@ -0,0 +1,263 @@
+#ifndef CASELFPLAY_H
+#define CASELFPLAY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "CAbase.h"
+#include "CArandom.h"
+#include "CAsnake.h"
+#include "CAworkers.h"
+
+
+class CAsnakeGame {
+    // One headless game of Snake: the universe with the cells of the snake (see CAsnake.h)
+    // and the snake itself, without any timer or key. The board is observed through cell().
+
+public:
+    explicit CAsnakeGame(int size) :
+        ca(size, size),
+        steps(0),
+        result(CAsnake::DIED),
+        seed(0)
+    {
+        ca.setBitPacked(false);
+    }
+
+    void reset(uint64_t gameSeed) {
+        seed = gameSeed;
+        snake.reset(ca, gameSeed);
+        steps = 0;
+        result = CAsnake::MOVED;
+    }
+
+    CAsnake::Result step(CAsnake::Direction d) {
+        // a turn back into the body is ignored, the snake goes on straight ahead then
+        snake.turn(d);
+        result = snake.step(ca);
+        steps++;
+        return result;
+    }
+
+    bool isOver() {
+        return result == CAsnake::DIED || result == CAsnake::WON;
+    }
+
+    int getSize() {
+        return ca.getNx();
+    }
+
+    int cell(int x, int y) {
+        // -1 wall (and the border x, y = 0, size + 1), 0 free, FOOD, HEAD or BODY
+        return ca.isAlive(x, y);
+    }
+
+    int getHeadX() {
+        return snake.getHead() % ca.getNx() + 1;
+    }
+
+    int getHeadY() {
+        return snake.getHead() / ca.getNx() + 1;
+    }
+
+    int getFoodX() {
+        return snake.getFood() < 0 ? 0 : snake.getFood() % ca.getNx() + 1;
+    }
+
+    int getFoodY() {
+        return snake.getFood() < 0 ? 0 : snake.getFood() / ca.getNx() + 1;
+    }
+
+    CAsnake::Direction getDirection() {
+        return snake.getDirection();
+    }
+
+    int getLength() {
+        return snake.getLength();
+    }
+
+    int64_t getSteps() {
+        return steps;
+    }
+
+    CAsnake::Result getResult() {
+        return result;
+    }
+
+    uint64_t getSeed() {
+        // policies that play at random draw from it, so every game can be replayed
+        return seed;
+    }
+
+private:
+    CAbase ca;
+    CAsnake snake;
+    int64_t steps;
+    CAsnake::Result result;
+    uint64_t seed;
+};
+
+
+class CAsnakePolicy {
+    // A bot: picks the direction of the next step. Every game gets its own policy
+    // (see CAselfplay::run), so a policy may keep state between the steps of its game.
+
+public:
+    virtual ~CAsnakePolicy() {}
+    virtual void reset(CAsnakeGame &) {} // before the first step of a game
+    virtual CAsnake::Direction decide(CAsnakeGame &game) = 0;
+
+protected:
+    static bool isSafe(CAsnakeGame &game, CAsnake::Direction d) {
+        // the cell in direction d is no wall and no body (the tail may move on, it is not counted)
+        int x = game.getHeadX() + (d == CAsnake::RIGHT) - (d == CAsnake::LEFT);
+        int y = game.getHeadY() + (d == CAsnake::DOWN) - (d == CAsnake::UP);
+        int v = game.cell(x, y);
+        return v == 0 || v == CAsnake::FOOD;
+    }
+};
+
+
+class CAsnakeRandom : public CAsnakePolicy {
+    // any direction that does not end the game at once
+
+public:
+    void reset(CAsnakeGame &game) {
+        seed = game.getSeed() ^ 0xD1B54A32D192ED03ULL;
+    }
+
+    CAsnake::Direction decide(CAsnakeGame &game) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        int first = (int) (seed >> 62);
+        for (int i = 0; i < 4; i++) {
+            CAsnake::Direction d = (CAsnake::Direction) ((first + i) % 4);
+            if (isSafe(game, d))
+                return d;
+        }
+        return game.getDirection();
+    }
+
+private:
+    uint64_t seed;
+};
+
+
+class CAsnakeGreedy : public CAsnakePolicy {
+    // the safe direction that comes closest to the food
+
+public:
+    CAsnake::Direction decide(CAsnakeGame &game) {
+        CAsnake::Direction best = game.getDirection();
+        int bestDistance = 1 << 30;
+        for (int i = 0; i < 4; i++) {
+            CAsnake::Direction d = (CAsnake::Direction) i;
+            if (!isSafe(game, d))
+                continue;
+            int x = game.getHeadX() + (d == CAsnake::RIGHT) - (d == CAsnake::LEFT);
+            int y = game.getHeadY() + (d == CAsnake::DOWN) - (d == CAsnake::UP);
+            int distance = abs(x - game.getFoodX()) + abs(y - game.getFoodY());
+            if (distance < bestDistance) {
+                best = d;
+                bestDistance = distance;
+            }
+        }
+        return best;
+    }
+};
+
+
+class CAsnakeCycle : public CAsnakePolicy {
+    // up to the first row, then along a cycle through all cells: column 1 upwards, the other
+    // columns row by row; never dies and fills the universe, needs an even size
+
+public:
+    void reset(CAsnakeGame &) {
+        onCycle = false;
+    }
+
+    CAsnake::Direction decide(CAsnakeGame &game) {
+        int x = game.getHeadX(), y = game.getHeadY(), n = game.getSize();
+        onCycle = onCycle || y == 1;
+        if (!onCycle)
+            return CAsnake::UP;
+        if (x == 1)
+            return y > 1 ? CAsnake::UP : CAsnake::RIGHT;
+        if (y % 2)
+            return x < n ? CAsnake::RIGHT : CAsnake::DOWN;
+        return (y == n || x > 2) ? CAsnake::LEFT : CAsnake::DOWN;
+    }
+
+private:
+    bool onCycle;
+};
+
+
+class CAselfplay {
+    // Many independent games at once: every game is a task of the worker pool, played from
+    // its own seed (derived from the seed of the run and its number) with its own policy,
+    // so the results do not depend on the number of threads.
+
+public:
+    typedef std::function<std::unique_ptr<CAsnakePolicy>()> PolicyFactory;
+
+    struct Game {
+        uint64_t seed;
+        int64_t steps;
+        int length;
+        CAsnake::Result result; // DIED, WON, or MOVED / ATE when maxSteps ran out
+    };
+
+    explicit CAselfplay(int threads) :
+        workers(threads),
+        seconds(0)
+        {}
+
+    const std::vector<Game> &run(int games, int size, uint64_t seed, const PolicyFactory &policy,
+                                 int64_t maxSteps);
+
+    int64_t getSteps() {
+        // steps of all games of the last run
+        int64_t sum = 0;
+        for (size_t i = 0; i < results.size(); i++)
+            sum += results[i].steps;
+        return sum;
+    }
+
+    double getSeconds() {
+        return seconds;
+    }
+
+private:
+    CAworkers workers;
+    std::vector<Game> results;
+    double seconds;
+};
+
+
+inline const std::vector<CAselfplay::Game> &CAselfplay::run(int games, int size, uint64_t seed,
+                                                            const PolicyFactory &policy, int64_t maxSteps) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    results.assign(std::max(games, 0), Game());
+    workers.run(games, [&](int g) {
+        CAsnakeGame game(size);
+        std::unique_ptr<CAsnakePolicy> bot = policy();
+        game.reset(splitmix64Seed(seed, g));
+        bot->reset(game);
+        while (!game.isOver() && game.getSteps() < maxSteps)
+            game.step(bot->decide(game));
+
+        Game &r = results[g];
+        r.seed = game.getSeed();
+        r.steps = game.getSteps();
+        r.length = game.getLength();
+        r.result = game.getResult();
+    });
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return results;
+}
+
+
+#endif // CASELFPLAY_H
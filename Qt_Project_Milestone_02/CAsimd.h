@@ -0,0 +1,372 @@
+#ifndef CASIMD_H
+#define CASIMD_H
+
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CA_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+
+// Life-like rules ("B3/S23"): a cell is born with n living neighbours if bit n of the birth
+// mask is set and survives with n if bit n of the survive mask is set (see CArule).
+//
+// The kernels are templates over both masks. A rule given as template argument is folded
+// into the code at compile time; RULE_RUNTIME instead takes the masks passed at run time,
+// so any rule works, with a little more work per cell than a compiled one.
+
+enum { RULE_RUNTIME = 0x200 };
+
+inline unsigned ruleMask(unsigned compiled, unsigned runtime) {
+    return compiled == RULE_RUNTIME ? runtime : compiled;
+}
+
+template <unsigned B, unsigned S> struct Rule {};
+template <class... R> struct RuleList {};
+
+// rules with their own compiled kernels: Life, HighLife, Seeds, Day & Night, Life without
+// Death, Replicator, Maze, Diamoeba, 2x2, Morley, Anneal
+typedef RuleList<Rule<0x008, 0x00C>, Rule<0x048, 0x00C>, Rule<0x004, 0x000>, Rule<0x1C8, 0x1D8>,
+                 Rule<0x008, 0x1FF>, Rule<0x0AA, 0x0AA>, Rule<0x008, 0x03E>, Rule<0x1E8, 0x1E0>,
+                 Rule<0x048, 0x026>, Rule<0x148, 0x0B4>, Rule<0x1D0, 0x1E8> > CompiledRules;
+
+template <template <unsigned, unsigned> class K>
+inline typename K<RULE_RUNTIME, RULE_RUNTIME>::Type pickRule(unsigned, unsigned, RuleList<>) {
+    return K<RULE_RUNTIME, RULE_RUNTIME>::get();
+}
+
+template <template <unsigned, unsigned> class K, unsigned B, unsigned S, class... R>
+inline typename K<RULE_RUNTIME, RULE_RUNTIME>::Type pickRule(unsigned birth, unsigned survive, RuleList<Rule<B, S>, R...>) {
+    // K<B, S>::get() of the compiled rule equal to birth / survive, or the RULE_RUNTIME one
+    if (birth == B && survive == S) return K<B, S>::get();
+    return pickRule<K>(birth, survive, RuleList<R...>());
+}
+
+
+// Row kernels for the byte universe (see CAbase).
+//
+// up, mid and down point to the same column of three adjacent rows, out to that column in
+// the evolution universe. n cells are evolved; the columns left and right of them must be
+// readable (no wrap-around is done here). The result is the same as the one of
+// CAbase::cellEvolutionLife: a cell with value 1 lives on if the rule lets it survive, any
+// other cell becomes 1 if the rule lets it be born and keeps its value otherwise.
+
+typedef void (*LifeRowKernel)(const int8_t *up, const int8_t *mid, const int8_t *down, int8_t *out,
+                              int n, unsigned birth, unsigned survive);
+
+
+template <unsigned B, unsigned S>
+inline void lifeRowScalar(const int8_t *up, const int8_t *mid, const int8_t *down, int8_t *out,
+                          int n, unsigned runBirth, unsigned runSurvive) {
+    const unsigned birth = ruleMask(B, runBirth), survive = ruleMask(S, runSurvive);
+    for (int i = 0; i < n; i++) {
+        int c = (up[i - 1] == 1) + (up[i] == 1) + (up[i + 1] == 1)
+              + (mid[i - 1] == 1) + (mid[i + 1] == 1)
+              + (down[i - 1] == 1) + (down[i] == 1) + (down[i + 1] == 1);
+        int alive = -(mid[i] == 1);
+        int born = -(int) ((birth >> c) & 1);
+        int surv = (survive >> c) & 1;
+        int dead = (born & 1) | (~born & mid[i]);
+        out[i] = (int8_t) ((alive & surv) | (~alive & dead));
+    }
+}
+
+
+#ifdef CA_SIMD_X86
+
+template <unsigned B, unsigned S>
+inline void lifeRowSSE2(const int8_t *up, const int8_t *mid, const int8_t *down, int8_t *out,
+                        int n, unsigned runBirth, unsigned runSurvive) {
+    // 16 cells at once; the rule is applied as OR over the counts 0..8 of
+    // (count == k) & mask bit k, for a compiled rule the terms of the clear bits vanish
+    const unsigned birth = ruleMask(B, runBirth), survive = ruleMask(S, runSurvive);
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i bornMask[9], survMask[9];
+    for (int k = 0; k <= 8; k++) {
+        bornMask[k] = _mm_set1_epi8((char) -(int) ((birth >> k) & 1));
+        survMask[k] = _mm_set1_epi8((char) -(int) ((survive >> k) & 1));
+    }
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        // every comparison gives -1 for a living neighbour, the sum is the negative count
+        __m128i s = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (up + i - 1)), one);
+        s = _mm_add_epi8(s, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (up + i)), one));
+        s = _mm_add_epi8(s, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (up + i + 1)), one));
+        s = _mm_add_epi8(s, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (mid + i - 1)), one));
+        s = _mm_add_epi8(s, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (mid + i + 1)), one));
+        s = _mm_add_epi8(s, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (down + i - 1)), one));
+        s = _mm_add_epi8(s, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (down + i)), one));
+        s = _mm_add_epi8(s, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (down + i + 1)), one));
+        __m128i c = _mm_sub_epi8(_mm_setzero_si128(), s);
+
+        __m128i born = _mm_setzero_si128(), surv = _mm_setzero_si128();
+        for (int k = 0; k <= 8; k++) {
+            __m128i eq = _mm_cmpeq_epi8(c, _mm_set1_epi8((char) k));
+            born = _mm_or_si128(born, _mm_and_si128(eq, bornMask[k]));
+            surv = _mm_or_si128(surv, _mm_and_si128(eq, survMask[k]));
+        }
+
+        __m128i alive = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (mid + i)), one);
+        __m128i dead = _mm_or_si128(_mm_and_si128(born, one),
+                                    _mm_andnot_si128(born, _mm_loadu_si128((const __m128i *) (mid + i))));
+        __m128i res = _mm_or_si128(_mm_and_si128(alive, _mm_and_si128(surv, one)),
+                                   _mm_andnot_si128(alive, dead));
+        _mm_storeu_si128((__m128i *) (out + i), res);
+    }
+    lifeRowScalar<B, S>(up + i, mid + i, down + i, out + i, n - i, birth, survive);
+}
+
+
+template <unsigned B, unsigned S>
+__attribute__((target("avx2")))
+inline void lifeRowAVX2(const int8_t *up, const int8_t *mid, const int8_t *down, int8_t *out,
+                        int n, unsigned runBirth, unsigned runSurvive) {
+    // 32 cells at once; the rule is a table of 16 bytes (-1 for the counts in the mask)
+    // looked up with a byte shuffle, the same cost for any rule
+    const unsigned birth = ruleMask(B, runBirth), survive = ruleMask(S, runSurvive);
+    const __m256i one = _mm256_set1_epi8(1);
+    char bornTable[32], survTable[32];
+    for (int k = 0; k < 32; k++) {
+        bornTable[k] = (char) ((k & 15) <= 8 ? -(int) ((birth >> (k & 15)) & 1) : 0);
+        survTable[k] = (char) ((k & 15) <= 8 ? (int) ((survive >> (k & 15)) & 1) : 0);
+    }
+    const __m256i bornLookup = _mm256_loadu_si256((const __m256i *) bornTable);
+    const __m256i survLookup = _mm256_loadu_si256((const __m256i *) survTable);
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i s = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (up + i - 1)), one);
+        s = _mm256_add_epi8(s, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (up + i)), one));
+        s = _mm256_add_epi8(s, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (up + i + 1)), one));
+        s = _mm256_add_epi8(s, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (mid + i - 1)), one));
+        s = _mm256_add_epi8(s, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (mid + i + 1)), one));
+        s = _mm256_add_epi8(s, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (down + i - 1)), one));
+        s = _mm256_add_epi8(s, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (down + i)), one));
+        s = _mm256_add_epi8(s, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (down + i + 1)), one));
+        __m256i c = _mm256_sub_epi8(_mm256_setzero_si256(), s);
+
+        __m256i born = _mm256_shuffle_epi8(bornLookup, c);
+        __m256i surv = _mm256_shuffle_epi8(survLookup, c);
+
+        __m256i alive = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (mid + i)), one);
+        __m256i dead = _mm256_blendv_epi8(_mm256_loadu_si256((const __m256i *) (mid + i)), one, born);
+        __m256i res = _mm256_blendv_epi8(dead, surv, alive);
+        _mm256_storeu_si256((__m256i *) (out + i), res);
+    }
+    lifeRowSSE2<B, S>(up + i, mid + i, down + i, out + i, n - i, birth, survive);
+}
+
+#endif // CA_SIMD_X86
+
+
+inline void lifeCount(const uint64_t west[3], const uint64_t mid[3], const uint64_t east[3],
+                      uint64_t &ones, uint64_t &twos, uint64_t &fours, uint64_t &eights) {
+    // Neighbour count of 64 bit-packed cells of the middle row at once. west, mid and east are
+    // the upper, middle and lower row shifted so that bit i holds the left, own and right
+    // neighbour of cell i. The eight neighbours of every bit are summed with bitwise full adders
+    // into the binary counters ones, twos, fours, eights.
+
+    // full adders over the upper and lower row, half adder over the left and right neighbour
+    uint64_t s1 = west[0] ^ mid[0] ^ east[0];
+    uint64_t c1 = (west[0] & mid[0]) | (east[0] & (west[0] ^ mid[0]));
+    uint64_t s2 = west[2] ^ mid[2] ^ east[2];
+    uint64_t c2 = (west[2] & mid[2]) | (east[2] & (west[2] ^ mid[2]));
+    uint64_t s3 = west[1] ^ east[1];
+    uint64_t c3 = west[1] & east[1];
+
+    ones = s1 ^ s2 ^ s3;
+    uint64_t c4 = (s1 & s2) | (s3 & (s1 ^ s2));
+
+    // four carries of weight 2
+    uint64_t t1 = c1 ^ c2 ^ c3;
+    uint64_t t2 = (c1 & c2) | (c3 & (c1 ^ c2));
+    twos = t1 ^ c4;
+    fours = t2 ^ (t1 & c4);
+    eights = t2 & t1 & c4;
+}
+
+
+inline uint64_t lifeWord(const uint64_t west[3], const uint64_t mid[3], const uint64_t east[3]) {
+    // Classic Game of Life for 64 bit-packed cells, see lifeCount; the count modulo 8 is
+    // enough for B3/S23, so eights is not used
+    uint64_t ones, twos, fours, eights;
+    lifeCount(west, mid, east, ones, twos, fours, eights);
+
+    // born with 3, survives with 2 or 3
+    return ~fours & twos & (ones | mid[1]);
+}
+
+
+inline void ruleCount(unsigned birth, unsigned survive, int k, uint64_t count, uint64_t &born, uint64_t &surv) {
+    // add the cells with k neighbours to the ones born / surviving if the rule says so
+    born |= count & (0 - (uint64_t) ((birth >> k) & 1));
+    surv |= count & (0 - (uint64_t) ((survive >> k) & 1));
+}
+
+
+template <unsigned B, unsigned S>
+inline uint64_t ruleWord(const uint64_t west[3], const uint64_t mid[3], const uint64_t east[3],
+                         unsigned runBirth, unsigned runSurvive) {
+    // Life-like rule for 64 bit-packed cells: the cells with k neighbours are the AND of a
+    // term for the low two bits of k and one for its high bits (8 is the only count with
+    // eights), the cells born and surviving the OR of the counts in the masks. A compiled
+    // rule keeps only the terms of its counts.
+    const unsigned birth = ruleMask(B, runBirth), survive = ruleMask(S, runSurvive);
+    uint64_t ones, twos, fours, eights;
+    lifeCount(west, mid, east, ones, twos, fours, eights);
+
+    const uint64_t l0 = ~(ones | twos), l1 = ones & ~twos, l2 = twos & ~ones, l3 = ones & twos;
+    const uint64_t h0 = ~(fours | eights);
+    uint64_t born = 0, surv = 0;
+    ruleCount(birth, survive, 0, l0 & h0, born, surv);
+    ruleCount(birth, survive, 1, l1 & h0, born, surv);
+    ruleCount(birth, survive, 2, l2 & h0, born, surv);
+    ruleCount(birth, survive, 3, l3 & h0, born, surv);
+    ruleCount(birth, survive, 4, l0 & fours, born, surv);
+    ruleCount(birth, survive, 5, l1 & fours, born, surv);
+    ruleCount(birth, survive, 6, l2 & fours, born, surv);
+    ruleCount(birth, survive, 7, l3 & fours, born, surv);
+    ruleCount(birth, survive, 8, eights, born, surv);
+    return (mid[1] & surv) | (~mid[1] & born);
+}
+
+
+template <>
+inline uint64_t ruleWord<0x008, 0x00C>(const uint64_t west[3], const uint64_t mid[3], const uint64_t east[3],
+                                      unsigned, unsigned) {
+    return lifeWord(west, mid, east);
+}
+
+
+template <unsigned B, unsigned S>
+struct LifeRowKernelOf {
+    // best kernel for the cpu we are running on, chosen once
+    typedef LifeRowKernel Type;
+    static Type get() {
+#ifdef CA_SIMD_X86
+        static const Type kernel = __builtin_cpu_supports("avx2") ? lifeRowAVX2<B, S>
+                                 : __builtin_cpu_supports("sse2") ? lifeRowSSE2<B, S>
+                                 : lifeRowScalar<B, S>;
+        return kernel;
+#else
+        return lifeRowScalar<B, S>;
+#endif
+    }
+};
+
+
+inline LifeRowKernel lifeRowKernel(unsigned birth, unsigned survive) {
+    return pickRule<LifeRowKernelOf>(birth, survive, CompiledRules());
+}
+
+
+// Row kernels for the cyclic cellular automaton on byte states 0 .. states - 1.
+//
+// A cell in state s advances to s + 1 (states - 1 to 0) if at least threshold of its
+// neighbours are in that state already, else it keeps s. Moore is the neighbourhood of
+// eight cells, von Neumann the one of four. up, mid and down point to the same column of
+// three adjacent rows, the columns left and right of the n cells must be readable.
+
+typedef void (*CyclicRowKernel)(const uint8_t *up, const uint8_t *mid, const uint8_t *down, uint8_t *out, int n,
+                                int states, int threshold);
+
+
+template <bool Moore>
+inline void cyclicRowScalar(const uint8_t *up, const uint8_t *mid, const uint8_t *down, uint8_t *out, int n,
+                            int states, int threshold) {
+    for (int i = 0; i < n; i++) {
+        int next = mid[i] + 1 == states ? 0 : mid[i] + 1;
+        int c = (up[i] == next) + (mid[i - 1] == next) + (mid[i + 1] == next) + (down[i] == next);
+        if (Moore)
+            c += (up[i - 1] == next) + (up[i + 1] == next) + (down[i - 1] == next) + (down[i + 1] == next);
+        out[i] = (uint8_t) (c >= threshold ? next : mid[i]);
+    }
+}
+
+
+#ifdef CA_SIMD_X86
+
+template <bool Moore>
+inline void cyclicRowSSE2(const uint8_t *up, const uint8_t *mid, const uint8_t *down, uint8_t *out, int n,
+                          int states, int threshold) {
+    // 16 cells at once; every comparison gives -1 for a neighbour in the next state
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i last = _mm_set1_epi8((char) states);
+    const __m128i below = _mm_set1_epi8((char) (threshold - 1));
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i cur = _mm_loadu_si128((const __m128i *) (mid + i));
+        __m128i next = _mm_add_epi8(cur, one);
+        next = _mm_andnot_si128(_mm_cmpeq_epi8(next, last), next);
+
+        __m128i s = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (up + i)), next);
+        s = _mm_add_epi8(s, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (mid + i - 1)), next));
+        s = _mm_add_epi8(s, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (mid + i + 1)), next));
+        s = _mm_add_epi8(s, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (down + i)), next));
+        if (Moore) {
+            s = _mm_add_epi8(s, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (up + i - 1)), next));
+            s = _mm_add_epi8(s, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (up + i + 1)), next));
+            s = _mm_add_epi8(s, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (down + i - 1)), next));
+            s = _mm_add_epi8(s, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (down + i + 1)), next));
+        }
+        __m128i advance = _mm_cmpgt_epi8(_mm_sub_epi8(_mm_setzero_si128(), s), below);
+        __m128i res = _mm_or_si128(_mm_and_si128(advance, next), _mm_andnot_si128(advance, cur));
+        _mm_storeu_si128((__m128i *) (out + i), res);
+    }
+    cyclicRowScalar<Moore>(up + i, mid + i, down + i, out + i, n - i, states, threshold);
+}
+
+
+template <bool Moore>
+__attribute__((target("avx2")))
+inline void cyclicRowAVX2(const uint8_t *up, const uint8_t *mid, const uint8_t *down, uint8_t *out, int n,
+                          int states, int threshold) {
+    const __m256i one = _mm256_set1_epi8(1);
+    const __m256i last = _mm256_set1_epi8((char) states);
+    const __m256i below = _mm256_set1_epi8((char) (threshold - 1));
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i cur = _mm256_loadu_si256((const __m256i *) (mid + i));
+        __m256i next = _mm256_add_epi8(cur, one);
+        next = _mm256_andnot_si256(_mm256_cmpeq_epi8(next, last), next);
+
+        __m256i s = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (up + i)), next);
+        s = _mm256_add_epi8(s, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (mid + i - 1)), next));
+        s = _mm256_add_epi8(s, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (mid + i + 1)), next));
+        s = _mm256_add_epi8(s, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (down + i)), next));
+        if (Moore) {
+            s = _mm256_add_epi8(s, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (up + i - 1)), next));
+            s = _mm256_add_epi8(s, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (up + i + 1)), next));
+            s = _mm256_add_epi8(s, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (down + i - 1)), next));
+            s = _mm256_add_epi8(s, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (down + i + 1)), next));
+        }
+        __m256i advance = _mm256_cmpgt_epi8(_mm256_sub_epi8(_mm256_setzero_si256(), s), below);
+        __m256i res = _mm256_blendv_epi8(cur, next, advance);
+        _mm256_storeu_si256((__m256i *) (out + i), res);
+    }
+    cyclicRowSSE2<Moore>(up + i, mid + i, down + i, out + i, n - i, states, threshold);
+}
+
+#endif // CA_SIMD_X86
+
+
+template <bool Moore>
+inline CyclicRowKernel cyclicRowKernelOf() {
+#ifdef CA_SIMD_X86
+    static const CyclicRowKernel kernel = __builtin_cpu_supports("avx2") ? cyclicRowAVX2<Moore>
+                                        : __builtin_cpu_supports("sse2") ? cyclicRowSSE2<Moore>
+                                        : cyclicRowScalar<Moore>;
+    return kernel;
+#else
+    return cyclicRowScalar<Moore>;
+#endif
+}
+
+
+inline CyclicRowKernel cyclicRowKernel(bool moore) {
+    // best kernel for the cpu we are running on and the neighbourhood
+    return moore ? cyclicRowKernelOf<true>() : cyclicRowKernelOf<false>();
+}
+
+
+#endif // CASIMD_H
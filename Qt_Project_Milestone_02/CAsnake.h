@@ -0,0 +1,226 @@
+#ifndef CASNAKE_H
+#define CASNAKE_H
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+#include "CAbase.h"
+#include "CArandom.h"
+
+
+class CAsnake {
+    // Snake on the cells of the int universe of CAbase (see Notizen): border and walls are -1,
+    // food is FOOD, the head HEAD and the rest of the body BODY. Cells are numbered
+    // (y - 1) * nx + x - 1.
+    //
+    // The body is a ring buffer of cell numbers from the tail to the head, so a step only
+    // writes the new head and clears the old tail. An occupancy bitmap answers "is the body
+    // here" at once, and the free cells (neither body nor wall) are kept in an array with the
+    // position of every cell in it: taking a cell out or putting it back swaps it with the
+    // last one, and the food is an array element chosen at random. Every step costs the same,
+    // whatever the length of the snake.
+
+public:
+    enum { FOOD = 5, HEAD = 10, BODY = 11 };
+    enum Direction { UP, RIGHT, DOWN, LEFT };
+    enum Result { MOVED, ATE, DIED, WON };
+
+    CAsnake() :
+        nx(0),
+        ny(0),
+        head(0),
+        length(0),
+        food(NONE),
+        direction(UP),
+        alive(false),
+        seed(0)
+        {}
+
+    void reset(CAbase &ca, uint64_t randomSeed, int startLength = 3); // new snake on the cleared universe
+    void turn(Direction d); // queued for the next steps, a turn back into the body is ignored
+    Result step(CAbase &ca);
+
+    int getLength() {
+        return (int) length;
+    }
+
+    bool isAlive() {
+        return alive;
+    }
+
+    Direction getDirection() {
+        return direction;
+    }
+
+    int getHead() {
+        // cell number of the head
+        return (int) body[head];
+    }
+
+    int getFood() {
+        // cell number of the food, -1 if there is none (the snake fills the universe)
+        return food == NONE ? -1 : (int) food;
+    }
+
+    bool isBody(uint32_t cell) {
+        return (occupied[cell >> 6] >> (cell & 63)) & 1;
+    }
+
+private:
+    enum { NONE = 0xFFFFFFFFu };
+
+    void take(uint32_t cell); // cell is no longer free
+    void give(uint32_t cell); // cell is free again
+    void placeFood(CAbase &ca);
+    void set(CAbase &ca, uint32_t cell, int value) {
+        ca.setAlive(cell % nx + 1, cell / nx + 1, value);
+    }
+
+    int nx;
+    int ny;
+    std::vector<uint32_t> body; // ring buffer, capacity nx * ny
+    size_t head; // position of the head in body, the tail is length - 1 before it
+    size_t length;
+    std::vector<uint64_t> occupied; // one bit per cell of the body
+    std::vector<uint32_t> freeCells;
+    std::vector<uint32_t> freePos; // position of every cell in freeCells, NONE if not free
+    uint32_t food;
+    Direction direction;
+    std::deque<Direction> turns;
+    bool alive;
+    uint64_t seed;
+};
+
+
+inline void CAsnake::reset(CAbase &ca, uint64_t randomSeed, int startLength) {
+    // the snake starts at the bottom in the middle, heading up, with one food somewhere else
+    ca.resetWorldSize(ca.getNx(), ca.getNy());
+    nx = ca.getNx();
+    ny = ca.getNy();
+    const uint32_t cells = (uint32_t) nx * ny;
+    body.assign(cells, 0);
+    occupied.assign((cells + 63) / 64, 0);
+    freeCells.resize(cells);
+    freePos.resize(cells);
+    for (uint32_t c = 0; c < cells; c++) {
+        freeCells[c] = c;
+        freePos[c] = c;
+    }
+    seed = randomSeed;
+    direction = UP;
+    turns.clear();
+
+    startLength = std::max(1, std::min(startLength, ny));
+    const int x = (nx + 1) / 2;
+    length = 0;
+    for (int y = ny; y > ny - startLength; y--) {
+        uint32_t cell = (uint32_t) (y - 1) * nx + x - 1;
+        head = length++;
+        body[head] = cell;
+        occupied[cell >> 6] |= uint64_t(1) << (cell & 63);
+        take(cell);
+        set(ca, cell, y == ny - startLength + 1 ? HEAD : BODY);
+    }
+    alive = true;
+    food = NONE;
+    placeFood(ca);
+}
+
+
+inline void CAsnake::turn(Direction d) {
+    // a few turns are kept, so quick key presses between two steps are not lost
+    Direction last = turns.empty() ? direction : turns.back();
+    if (d == last || (d + 2) % 4 == last || turns.size() >= 3)
+        return;
+    turns.push_back(d);
+}
+
+
+inline CAsnake::Result CAsnake::step(CAbase &ca) {
+    if (!alive)
+        return DIED;
+    if (!turns.empty()) {
+        direction = turns.front();
+        turns.pop_front();
+    }
+
+    // the cell ahead: a wall outside the universe or a -1 cell
+    const uint32_t cur = body[head];
+    int x = (int) (cur % nx) + 1, y = (int) (cur / nx) + 1;
+    x += (direction == RIGHT) - (direction == LEFT);
+    y += (direction == DOWN) - (direction == UP);
+    if (x < 1 || x > nx || y < 1 || y > ny || ca.isAlive(x, y) == -1) {
+        alive = false;
+        return DIED;
+    }
+    const uint32_t next = (uint32_t) (y - 1) * nx + x - 1;
+    const bool ate = next == food;
+
+    // the tail moves on first, so the head may follow it into its cell
+    if (!ate) {
+        uint32_t tail = body[(head + body.size() - length + 1) % body.size()];
+        occupied[tail >> 6] &= ~(uint64_t(1) << (tail & 63));
+        give(tail);
+        set(ca, tail, 0);
+        length--;
+    }
+    if (isBody(next)) {
+        alive = false;
+        return DIED;
+    }
+
+    if (length)
+        set(ca, cur, BODY); // unless the tail was the head itself (a snake of length 1) and is gone
+    head = (head + 1) % body.size();
+    body[head] = next;
+    length++;
+    occupied[next >> 6] |= uint64_t(1) << (next & 63);
+    take(next);
+    set(ca, next, HEAD);
+
+    if (!ate)
+        return MOVED;
+    food = NONE;
+    placeFood(ca);
+    if (food == NONE) {
+        alive = false;
+        return WON;
+    }
+    return ATE;
+}
+
+
+inline void CAsnake::take(uint32_t cell) {
+    uint32_t pos = freePos[cell];
+    if (pos == NONE) return;
+    uint32_t last = freeCells.back();
+    freeCells[pos] = last;
+    freePos[last] = pos;
+    freeCells.pop_back();
+    freePos[cell] = NONE;
+}
+
+
+inline void CAsnake::give(uint32_t cell) {
+    if (freePos[cell] != NONE) return;
+    freePos[cell] = (uint32_t) freeCells.size();
+    freeCells.push_back(cell);
+}
+
+
+inline void CAsnake::placeFood(CAbase &ca) {
+    // uniform among the free cells (splitmix64, reproducible from the seed); walls are no food
+    while (!freeCells.empty()) {
+        uint32_t cell = freeCells[splitmix64(seed) % freeCells.size()];
+        if (ca.isAlive(cell % nx + 1, cell / nx + 1) == -1) {
+            take(cell);
+            continue;
+        }
+        food = cell;
+        set(ca, cell, FOOD);
+        return;
+    }
+}
+
+
+#endif // CASNAKE_H
@@ -0,0 +1,230 @@
+#ifndef CASPARSE_H
+#define CASPARSE_H
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include "CAbase.h"
+#include "CAsimd.h"
+
+
+// Unbounded Classic Game of Life.
+//
+// The universe is a hash map of chunks of 64 x 64 bit-packed cells with 64 bit signed
+// coordinates. A chunk exists only while it has living cells: chunks next to living
+// cells are evolved, chunks that end up empty are freed. Memory therefore follows the
+// living area, not the size of the bounding box.
+
+class CAsparse {
+
+public:
+    CAsparse() :
+        generation(0),
+        nochanges(false)
+        {}
+
+    void clear() {
+        chunks.clear();
+        generation = 0;
+        nochanges = false;
+    }
+
+    void setCell(int64_t x, int64_t y, bool alive);
+    bool getCell(int64_t x, int64_t y);
+
+    void importWorld(CAbase &ca, int64_t x0 = 0, int64_t y0 = 0);
+    void exportWorld(CAbase &ca, int64_t x0 = 0, int64_t y0 = 0);
+
+    void step();
+
+    bool isNotChanged() {
+        return nochanges;
+    }
+
+    uint64_t getGeneration() {
+        return generation;
+    }
+
+    uint64_t getPopulation();
+
+    size_t getChunks() {
+        return chunks.size();
+    }
+
+private:
+    enum { CHUNK = 64 };
+
+    struct Chunk {
+        uint64_t row[CHUNK]; // bit i of row r is cell (cx * 64 + i, cy * 64 + r)
+    };
+
+    struct Key {
+        int64_t cx, cy;
+        bool operator==(const Key &k) const {
+            return cx == k.cx && cy == k.cy;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &k) const {
+            uint64_t h = (uint64_t) k.cx * 0x9E3779B97F4A7C15ULL;
+            h = (h ^ (uint64_t) k.cy) * 0xC2B2AE3D27D4EB4FULL;
+            return (size_t) (h ^ (h >> 31));
+        }
+    };
+
+    typedef std::unordered_map<Key, Chunk, KeyHash> ChunkMap;
+
+    static int64_t chunkOf(int64_t v) {
+        // floor division by 64, also for negative coordinates
+        return v >> 6;
+    }
+
+    const Chunk *find(int64_t cx, int64_t cy) {
+        Key k = {cx, cy};
+        ChunkMap::const_iterator it = chunks.find(k);
+        return it == chunks.end() ? 0 : &it->second;
+    }
+
+    bool evolveChunk(int64_t cx, int64_t cy, Chunk &out);
+
+    ChunkMap chunks;
+    ChunkMap chunksNew;
+    uint64_t generation;
+    bool nochanges;
+};
+
+
+inline void CAsparse::setCell(int64_t x, int64_t y, bool alive) {
+    Key k = {chunkOf(x), chunkOf(y)};
+    uint64_t m = uint64_t(1) << (x & 63);
+    ChunkMap::iterator it = chunks.find(k);
+    if (it == chunks.end()) {
+        if (!alive) return;
+        Chunk c = {};
+        it = chunks.insert(std::make_pair(k, c)).first;
+    }
+    if (alive) it->second.row[y & 63] |= m;
+    else it->second.row[y & 63] &= ~m;
+}
+
+
+inline bool CAsparse::getCell(int64_t x, int64_t y) {
+    const Chunk *c = find(chunkOf(x), chunkOf(y));
+    return c && ((c->row[y & 63] >> (x & 63)) & 1);
+}
+
+
+inline uint64_t CAsparse::getPopulation() {
+    uint64_t pop = 0;
+    for (ChunkMap::const_iterator it = chunks.begin(); it != chunks.end(); ++it)
+        for (int r = 0; r < CHUNK; r++)
+            pop += __builtin_popcountll(it->second.row[r]);
+    return pop;
+}
+
+
+inline bool CAsparse::evolveChunk(int64_t cx, int64_t cy, Chunk &out) {
+    // next generation of chunk cx, cy from it and its eight neighbours, returns true if not empty
+    static const Chunk none = {};
+    const Chunk *n[3][3];
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            const Chunk *c = find(cx + dx, cy + dy);
+            n[dy + 1][dx + 1] = c ? c : &none;
+        }
+    }
+
+    uint64_t any = 0;
+    for (int r = 0; r < CHUNK; r++) {
+        uint64_t west[3], mid[3], east[3];
+        for (int i = 0; i < 3; i++) {
+            // row r - 1 + i, taken from the chunk above or below at the edges
+            int rr = r - 1 + i;
+            int cyi = 1 + (rr < 0 ? -1 : (rr >= CHUNK ? 1 : 0));
+            rr &= 63;
+            uint64_t cur = n[cyi][1]->row[rr];
+            west[i] = (cur << 1) | (n[cyi][0]->row[rr] >> 63);
+            mid[i] = cur;
+            east[i] = (cur >> 1) | (n[cyi][2]->row[rr] << 63);
+        }
+        out.row[r] = lifeWord(west, mid, east);
+        any |= out.row[r];
+    }
+    return any != 0;
+}
+
+
+inline void CAsparse::step() {
+    // evolve every chunk and every neighbour of a chunk; empty results are dropped
+    chunksNew.clear();
+    nochanges = true;
+
+    for (ChunkMap::const_iterator it = chunks.begin(); it != chunks.end(); ++it) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                Key k = {it->first.cx + dx, it->first.cy + dy};
+                if (chunksNew.count(k)) continue;
+
+                // empty results are kept until the end, so no chunk is evolved twice
+                Chunk &c = chunksNew[k];
+                bool alive = evolveChunk(k.cx, k.cy, c);
+                if (nochanges) {
+                    const Chunk *old = find(k.cx, k.cy);
+                    if (old) {
+                        for (int r = 0; r < CHUNK; r++)
+                            if (old->row[r] != c.row[r]) nochanges = false;
+                    }
+                    else if (alive) {
+                        nochanges = false;
+                    }
+                }
+            }
+        }
+    }
+
+    // drop the empty chunks
+    for (ChunkMap::iterator it = chunksNew.begin(); it != chunksNew.end(); ) {
+        uint64_t any = 0;
+        for (int r = 0; r < CHUNK; r++) any |= it->second.row[r];
+        if (any) ++it;
+        else it = chunksNew.erase(it);
+    }
+
+    chunks.swap(chunksNew);
+    generation++;
+}
+
+
+inline void CAsparse::importWorld(CAbase &ca, int64_t x0, int64_t y0) {
+    // the living cells of ca become cells x0 .. x0 + Nx - 1, y0 .. y0 + Ny - 1
+    for (int iy = 1; iy <= ca.getNy(); iy++)
+        for (int ix = 1; ix <= ca.getNx(); ix++)
+            if (ca.isAlive(ix, iy) == 1) setCell(x0 + ix - 1, y0 + iy - 1, true);
+}
+
+
+inline void CAsparse::exportWorld(CAbase &ca, int64_t x0, int64_t y0) {
+    // copy the window starting at x0, y0 into ca, row by row as bits: setRowBits only
+    // writes (and marks the tiles of) the cells that differ from the last export
+    const int n = ca.getRowWords();
+    const int s = (int) (x0 & 63); // position of x0 in its chunk
+    std::vector<uint64_t> row(n);
+    std::vector<const Chunk *> band(n + 1); // chunks of the window in the current chunk row
+    for (int iy = 0; iy < ca.getNy(); iy++) {
+        const int64_t y = y0 + iy;
+        if (iy == 0 || (y & 63) == 0)
+            for (int w = 0; w <= n; w++)
+                band[w] = find(chunkOf(x0) + w, chunkOf(y));
+        for (int w = 0; w < n; w++) {
+            // cells x0 + 64 w .. x0 + 64 w + 63 from up to two chunks
+            uint64_t lo = band[w] ? band[w]->row[y & 63] : 0;
+            uint64_t hi = band[w + 1] ? band[w + 1]->row[y & 63] : 0;
+            row[w] = s ? (lo >> s) | (hi << (64 - s)) : lo;
+        }
+        ca.setRowBits(iy + 1, &row[0]);
+    }
+}
+
+
+#endif // CASPARSE_H
@@ -0,0 +1,189 @@
+#ifndef CASTATS_H
+#define CASTATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+
+class CAstats {
+    // Durations of the phases of a generation (evolution, rendering, painting) over the last
+    // WINDOW samples of every phase. A sample goes into a histogram with four buckets per
+    // power of two nanoseconds, and the one falling out of the window is taken out again,
+    // so adding costs the same whatever the window holds and percentiles need no sorting.
+    // Not thread safe, every thread keeps its own.
+
+public:
+    enum Phase { EVOLVE, RENDER, PAINT_GRID, PAINT_UNIVERSE, PHASES };
+    enum { WINDOW = 1024, BUCKETS = 160 };
+
+    CAstats() {
+        clear();
+    }
+
+    static int64_t now() {
+        // nanoseconds of a monotonic clock
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static const char *phaseName(int phase) {
+        static const char *names[PHASES] = {"evolve", "render", "paint grid", "paint universe"};
+        return names[phase];
+    }
+
+    void clear();
+    void add(int phase, int64_t ns);
+
+    int getCount(int phase) {
+        // samples in the window
+        return rolling[phase].count;
+    }
+
+    int64_t getLast(int phase) {
+        Rolling &r = rolling[phase];
+        return r.count ? r.samples[(r.next + WINDOW - 1) % WINDOW] : 0;
+    }
+
+    double getMean(int phase) {
+        Rolling &r = rolling[phase];
+        return r.count ? (double) r.sum / r.count : 0;
+    }
+
+    int64_t getPercentile(int phase, double q); // upper end of the bucket, at most 25 % above the sample
+
+private:
+    static int bucketOf(int64_t ns) {
+        // four buckets per power of two: the position of the highest bit and the two bits below it
+        if (ns < 4) return ns < 0 ? 0 : (int) ns;
+        int high = 63 - __builtin_clzll((uint64_t) ns);
+        int b = 4 * (high - 1) + (int) ((ns >> (high - 2)) & 3);
+        return b < BUCKETS ? b : BUCKETS - 1;
+    }
+
+    static int64_t bucketEnd(int b) {
+        if (b < 4) return b;
+        int high = b / 4 + 1;
+        return ((int64_t) (4 + b % 4 + 1) << (high - 2)) - 1;
+    }
+
+    struct Rolling {
+        int64_t samples[WINDOW];
+        uint32_t counts[BUCKETS];
+        int count;
+        int next;
+        int64_t sum;
+    };
+    Rolling rolling[PHASES];
+};
+
+
+inline void CAstats::clear() {
+    for (int p = 0; p < PHASES; p++) {
+        Rolling &r = rolling[p];
+        for (int b = 0; b < BUCKETS; b++)
+            r.counts[b] = 0;
+        r.count = 0;
+        r.next = 0;
+        r.sum = 0;
+    }
+}
+
+
+inline void CAstats::add(int phase, int64_t ns) {
+    Rolling &r = rolling[phase];
+    if (r.count == WINDOW) {
+        // the oldest sample leaves the window
+        r.counts[bucketOf(r.samples[r.next])]--;
+        r.sum -= r.samples[r.next];
+    }
+    else {
+        r.count++;
+    }
+    r.samples[r.next] = ns;
+    r.counts[bucketOf(ns)]++;
+    r.sum += ns;
+    r.next = (r.next + 1) % WINDOW;
+}
+
+
+inline int64_t CAstats::getPercentile(int phase, double q) {
+    Rolling &r = rolling[phase];
+    if (!r.count) return 0;
+    int64_t rank = (int64_t) (q * r.count);
+    if (rank >= r.count) rank = r.count - 1;
+    int64_t seen = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        seen += r.counts[b];
+        if (seen > rank) return bucketEnd(b);
+    }
+    return bucketEnd(BUCKETS - 1);
+}
+
+
+class CAtrace {
+    // Phases as "complete" events of the Chrome trace event format (JSON), to be opened in
+    // chrome://tracing or ui.perfetto.dev. Events of several threads may be written at once;
+    // thread is the row of the event in the viewer.
+
+public:
+    enum { SIMULATION = 1, GUI = 2 };
+
+    CAtrace() :
+        file(0),
+        epoch(0)
+        {}
+
+    ~CAtrace() {
+        close();
+    }
+
+    bool open(const std::string &filename);
+    void close();
+
+    void event(const char *name, int thread, int64_t start, int64_t ns); // start from CAstats::now()
+
+private:
+    CAtrace(const CAtrace &);
+    CAtrace &operator=(const CAtrace &);
+
+    std::mutex mutex;
+    FILE *file;
+    int64_t epoch;
+};
+
+
+inline bool CAtrace::open(const std::string &filename) {
+    close();
+    std::lock_guard<std::mutex> lock(mutex);
+    file = fopen(filename.c_str(), "w");
+    if (!file) return false;
+    fputs("{\"traceEvents\":[\n", file);
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"simulation\"}},\n"
+                  "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"gui\"}}",
+            SIMULATION, GUI);
+    epoch = CAstats::now();
+    return true;
+}
+
+
+inline void CAtrace::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file) return;
+    fputs("\n]}\n", file);
+    fclose(file);
+    file = 0;
+}
+
+
+inline void CAtrace::event(const char *name, int thread, int64_t start, int64_t ns) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file) return;
+    fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+            name, thread, (start - epoch) / 1e3, ns / 1e3);
+}
+
+
+#endif // CASTATS_H
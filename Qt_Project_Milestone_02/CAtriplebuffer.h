@@ -0,0 +1,62 @@
+#ifndef CATRIPLEBUFFER_H
+#define CATRIPLEBUFFER_H
+
+#include <atomic>
+
+
+template <class T>
+class CAtriplebuffer {
+    // Lock-free triple buffer for one writer and one reader thread.
+    // The writer fills getBack() and publishes it; the reader calls update() and then
+    // uses getFront(), which is always the latest complete buffer. Neither side ever
+    // waits for the other: the middle buffer is swapped with a single atomic exchange.
+
+public:
+    CAtriplebuffer() :
+        middle(1),
+        back(0),
+        front(2)
+        {}
+
+    // writer side
+
+    T &getBack() {
+        return buffers[back];
+    }
+
+    int getBackIndex() {
+        return back;
+    }
+
+    bool publish() {
+        // hand the back buffer to the reader, returns true if the previous one was never read
+        int old = middle.exchange(back | FRESH);
+        back = old & INDEX;
+        return (old & FRESH) != 0;
+    }
+
+    // reader side
+
+    bool update() {
+        // take the newest published buffer, returns false if there is none since the last call
+        if (!(middle.load() & FRESH)) return false;
+        int old = middle.exchange(front);
+        front = old & INDEX;
+        return true;
+    }
+
+    T &getFront() {
+        return buffers[front];
+    }
+
+private:
+    enum { INDEX = 3, FRESH = 4 };
+
+    T buffers[3];
+    std::atomic<int> middle; // index of the middle buffer, FRESH if it was published but not read
+    int back; // only used by the writer
+    int front; // only used by the reader
+};
+
+
+#endif // CATRIPLEBUFFER_H
@@ -0,0 +1,127 @@
+#ifndef CAWORKERS_H
+#define CAWORKERS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class CAworkers {
+    // Persistent pool of worker threads. run() hands out the tasks 0 .. n - 1
+    // to the workers and to the calling thread and returns when all are done.
+    // The threads live as long as the pool, so no thread is started per generation.
+
+public:
+    explicit CAworkers(int n) :
+        generation(0),
+        tasks(0),
+        next(0),
+        done(0),
+        busy(0),
+        quit(false)
+    {
+        for (int i = 1; i < n; i++)
+            threads.push_back(std::thread(&CAworkers::loop, this));
+    }
+
+    ~CAworkers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wakeup.notify_all();
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+    }
+
+    int getSize() {
+        // number of threads including the calling one
+        return (int) threads.size() + 1;
+    }
+
+    void run(int n, const std::function<void(int)> &f);
+
+private:
+    void work();
+    void loop();
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable finished;
+    std::function<void(int)> job;
+    unsigned generation;
+    int tasks;
+    std::atomic<int> next;
+    std::atomic<int> done;
+    int busy; // workers currently inside work()
+    bool quit;
+};
+
+
+inline void CAworkers::work() {
+    // take tasks until none is left
+    int t;
+    while ((t = next.fetch_add(1)) < tasks) {
+        job(t);
+        if (done.fetch_add(1) + 1 == tasks) {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.notify_all();
+        }
+    }
+}
+
+
+inline void CAworkers::loop() {
+    // worker thread: wait for a new batch of tasks, then help with it
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!quit && generation == seen)
+                wakeup.wait(lock);
+            if (quit) return;
+            seen = generation;
+            busy++;
+        }
+        work();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy--;
+        }
+        finished.notify_all();
+    }
+}
+
+
+inline void CAworkers::run(int n, const std::function<void(int)> &f) {
+    if (n <= 0) return;
+    if (threads.empty() || n == 1) {
+        for (int t = 0; t < n; t++) f(t);
+        return;
+    }
+
+    {
+        // a worker may still be leaving the previous batch
+        std::unique_lock<std::mutex> lock(mutex);
+        while (busy > 0)
+            finished.wait(lock);
+        job = f;
+        tasks = n;
+        next = 0;
+        done = 0;
+        generation++;
+    }
+    wakeup.notify_all();
+    work();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (done.load() < tasks)
+        finished.wait(lock);
+}
+
+
+#endif // CAWORKERS_H
@@ -0,0 +1,237 @@
+/*
+ *  Headless batch runner: evolves a saved game or a pattern file on CAbase without
+ *  QApplication and reports the final universe and the timing.
+ *
+ *  Needs no Qt, build it for example with
+ *      g++ -O2 -std=c++11 -pthread batch.cpp -o ca_batch
+ *
+ *  Usage: ca_batch <file.snake|file.ca|file.rle|file.cells> <generations> [options]
+ *      -o <file>     write the final universe as .snake file, or .ca / .rle by its
+ *                    extension (default: .snake on stdout)
+ *      -r <file>     record the run as trajectory file (.catr, see CArecorder.h)
+ *      -t <threads>  number of evolution threads (default: 1)
+ *      -b <rule>     Life-like rule such as B36/S23 (default: the one of a .ca or
+ *                    .rle file, else B3/S23)
+ *      -e <edges>    torus, dead or mirror (default: torus), see CAbase::Boundary
+ *      -s            stop when the universe is constant or in a cycle
+ *      -q            do not print the final universe, only the timing
+ *      --int         use the int universe instead of the bit-packed one
+ *
+ *  Universes larger than CAfile::MAX_SIZE cells per side are refused, whatever the format.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CAbase.h"
+#include "CAfile.h"
+#include "CArecorder.h"
+#include "CArule.h"
+
+
+static bool endsWith(const std::string &s, const std::string &end) {
+    return s.size() >= end.size() && s.compare(s.size() - end.size(), end.size(), end) == 0;
+}
+
+
+static bool loadSnake(const std::string &filename, CAbase &ca) {
+    /* .snake file as written by MainWindow::saveGame: size, rows of '*' and 'o', color, interval */
+    std::ifstream in(filename.c_str());
+    int size;
+    if (!(in >> size) || size < 1 || size > CAfile::MAX_SIZE)
+        return false;
+
+    ca.resetWorldSize(size, size);
+    for (int k = 1; k <= size; k++) {
+        std::string row;
+        if (!(in >> row))
+            return false;
+        for (int j = 1; j <= size && j <= (int) row.size(); j++)
+            if (row[j - 1] == '*') ca.setAlive(j, k, 1);
+    }
+    return true;
+}
+
+
+static bool loadCells(const std::string &filename, CAbase &ca, int size) {
+    /* plaintext pattern (.cells): '!' comment lines, 'O' or '*' living cells; centred in the universe */
+    std::ifstream in(filename.c_str());
+    if (!in)
+        return false;
+
+    std::vector<std::string> rows;
+    std::string line;
+    size_t width = 0;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        if (!line.empty() && line[0] == '!') continue;
+        rows.push_back(line);
+        if (line.size() > width) width = line.size();
+    }
+    if (size < (int) width + 2) size = (int) width + 2;
+    if (size < (int) rows.size() + 2) size = (int) rows.size() + 2;
+    if (size > CAfile::MAX_SIZE)
+        return false;
+
+    ca.resetWorldSize(size, size);
+    int x0 = (size - (int) width) / 2, y0 = (size - (int) rows.size()) / 2;
+    for (size_t k = 0; k < rows.size(); k++)
+        for (size_t j = 0; j < rows[k].size(); j++)
+            if (rows[k][j] == 'O' || rows[k][j] == '*') ca.setAlive(x0 + (int) j + 1, y0 + (int) k + 1, 1);
+    return true;
+}
+
+
+static bool loadFile(const std::string &filename, CAbase &ca) {
+    /* binary save (.ca) or Life RLE pattern (.rle), the pattern is centred in at least 50 x 50 cells;
+     * the rule is taken from the file */
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if (endsWith(filename, ".ca")) {
+        CAfile::Header header;
+        if (!CAfile::load(in, ca, header))
+            return false;
+        ca.setRule(header.birth, header.survive);
+        return true;
+    }
+    int width, height;
+    std::string rule;
+    if (!CAfile::readRLEHeader(in, width, height, &rule))
+        return false;
+    unsigned birth, survive;
+    if (CArule::parse(rule, birth, survive))
+        ca.setRule(birth, survive);
+    int size = std::max(50, std::max(width, height) + 2);
+    ca.resetWorldSize(size, size);
+    in.seekg(0);
+    return CAfile::loadRLE(in, ca);
+}
+
+
+static void writeSnake(std::ostream &out, CAbase &ca) {
+    /* same layout as MainWindow::saveGame, black cells and 300 ms interval */
+    int size = ca.getNx();
+    out << size << "\n";
+    std::string row(size, 'o');
+    for (int k = 1; k <= size; k++) {
+        for (int j = 1; j <= size; j++)
+            row[j - 1] = ca.isAlive(j, k) == 1 ? '*' : 'o';
+        out << row << "\n";
+    }
+    out << "0 0 0\n300\n";
+}
+
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " <file.snake|file.ca|file.rle|file.cells> <generations>"
+                  << " [-o file] [-r file] [-t threads] [-b rule] [-e edges] [-s] [-q] [--int]\n";
+        return 2;
+    }
+
+    std::string input = argv[1];
+    long long generations = atoll(argv[2]);
+    std::string output, recording, rule, edges = "torus";
+    int threads = 1;
+    bool stop = false, quiet = false, packed = true;
+    for (int i = 3; i < argc; i++) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) output = argv[++i];
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc) recording = argv[++i];
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc) rule = argv[++i];
+        else if (!strcmp(argv[i], "-e") && i + 1 < argc) edges = argv[++i];
+        else if (!strcmp(argv[i], "-s")) stop = true;
+        else if (!strcmp(argv[i], "-q")) quiet = true;
+        else if (!strcmp(argv[i], "--int")) packed = false;
+        else {
+            std::cerr << "unknown option " << argv[i] << "\n";
+            return 2;
+        }
+    }
+
+    CAbase ca;
+    ca.setBitPacked(packed);
+    ca.setThreads(threads);
+    bool ok;
+    if (endsWith(input, ".cells")) ok = loadCells(input, ca, 50);
+    else if (endsWith(input, ".ca") || endsWith(input, ".rle")) ok = loadFile(input, ca);
+    else ok = loadSnake(input, ca);
+    if (!ok) {
+        std::cerr << "could not load " << input << "\n";
+        return 1;
+    }
+    unsigned birth, survive;
+    if (!rule.empty()) {
+        if (!CArule::parse(rule, birth, survive)) {
+            std::cerr << "invalid rule " << rule << "\n";
+            return 2;
+        }
+        ca.setRule(birth, survive);
+    }
+    if (edges == "torus") ca.setBoundary(CAbase::TORUS);
+    else if (edges == "dead") ca.setBoundary(CAbase::DEAD);
+    else if (edges == "mirror") ca.setBoundary(CAbase::MIRROR);
+    else {
+        std::cerr << "invalid edges " << edges << "\n";
+        return 2;
+    }
+
+    CArecorder recorder;
+    if (!recording.empty() && !recorder.open(recording, ca)) {
+        std::cerr << "could not write " << recording << "\n";
+        return 1;
+    }
+
+    /* evolution */
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    long long done = 0;
+    while (done < generations) {
+        ca.worldEvolutionLife();
+        recorder.record(ca);
+        done++;
+        if (stop && (ca.isNotChanged() || ca.getPeriod() > 0))
+            break;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long long population = 0;
+    for (int k = 1; k <= ca.getNy(); k++)
+        for (int j = 1; j <= ca.getNx(); j++)
+            population += ca.isAlive(j, k) == 1;
+
+    /* final universe */
+    if (!output.empty()) {
+        std::ofstream out(output.c_str(), std::ios::binary);
+        CAfile::Header header;
+        header.birth = ca.getBirth();
+        header.survive = ca.getSurvive();
+        if (endsWith(output, ".ca")) CAfile::save(out, ca, header);
+        else if (endsWith(output, ".rle")) CAfile::saveRLE(out, ca);
+        else writeSnake(out, ca);
+        if (!out) {
+            std::cerr << "could not write " << output << "\n";
+            return 1;
+        }
+    }
+    else if (!quiet) {
+        writeSnake(std::cout, ca);
+    }
+
+    /* timing, one "key value" pair per line on stderr so stdout stays a valid .snake file */
+    std::ostream &report = output.empty() && !quiet ? std::cerr : std::cout;
+    report << "size " << ca.getNx() << "\n"
+           << "generations " << done << "\n"
+           << "seconds " << seconds << "\n"
+           << "generations_per_second " << (seconds > 0 ? done / seconds : 0) << "\n"
+           << "cells_per_second " << (seconds > 0 ? done * (double) ca.getNx() * ca.getNy() / seconds : 0) << "\n"
+           << "rule " << CArule::format(ca.getBirth(), ca.getSurvive()) << "\n"
+           << "population " << population << "\n"
+           << "period " << (ca.isNotChanged() ? 1 : ca.getPeriod()) << "\n";
+    return 0;
+}
@@ -0,0 +1,314 @@
+/*
+ *  Microbenchmarks for the evolution, paint and dump paths.
+ *
+ *  Build it with ca_benchmark.pro (qmake), from benchmark.cpp, gamewidget.cpp and simulation.cpp
+ *  instead of main.cpp and mainwindow.cpp. Run it without a display with QT_QPA_PLATFORM=offscreen.
+ *
+ *  Usage: ca_benchmark [-o file.json] [--sizes 50,400,2000,10000] [--budget seconds] [--threads n]
+ *
+ *  All universes are filled from a fixed seed, so runs of different builds are comparable.
+ *  The results are written as JSON, one object per measurement.
+ */
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QSysInfo>
+#include <QTextStream>
+
+#include "CArandom.h"
+#include "CAselfplay.h"
+#include "gamewidget.h"
+
+
+class GameBenchmark {
+
+public:
+    GameBenchmark(double budget, int threads) :
+        budget(budget),
+        threads(threads)
+        {}
+
+    QJsonObject evolution(int size, double density, bool packed);
+    QJsonObject cyclic(int size, int states, int threshold, bool moore);
+    QJsonObject snake(int size);
+    QJsonObject paint(int size, double density);
+    QJsonObject dump(int size, double density);
+
+private:
+    static void fill(CAbase &ca, double density, uint64_t seed);
+    static QString randomDump(int size, double density, uint64_t seed);
+
+    double budget; // seconds spent on every measurement
+    int threads; // threads of the evolutions
+};
+
+
+void GameBenchmark::fill(CAbase &ca, double density, uint64_t seed) {
+    /* random universe */
+    for (int k = 1; k <= ca.getNy(); k++)
+        for (int j = 1; j <= ca.getNx(); j++)
+            ca.setAlive(j, k, splitmix64Chance(seed, density) ? 1 : 0);
+}
+
+
+QString GameBenchmark::randomDump(int size, double density, uint64_t seed) {
+    /* random universe in the format of GameWidget::dumpGame */
+    QString data;
+    data.reserve(size * (size + 1));
+    for (int k = 1; k <= size; k++) {
+        for (int j = 1; j <= size; j++)
+            data.append(splitmix64Chance(seed, density) ? '*' : 'o');
+        data.append('\n');
+    }
+    return data;
+}
+
+
+QJsonObject GameBenchmark::evolution(int size, double density, bool packed) {
+    /* generations per second of worldEvolutionLife */
+    CAbase ca(size, size);
+    ca.setBitPacked(packed);
+    ca.setThreads(threads);
+    fill(ca, density, 1);
+
+    QElapsedTimer t;
+    t.start();
+    qint64 generations = 0;
+    while (generations < 3 || t.nsecsElapsed() < budget * 1e9) {
+        ca.worldEvolutionLife();
+        generations++;
+    }
+    double seconds = t.nsecsElapsed() / 1e9;
+
+    QJsonObject o;
+    o["benchmark"] = "worldEvolutionLife";
+    o["size"] = size;
+    o["density"] = density;
+    o["backend"] = packed ? "packed" : "int";
+    o["threads"] = ca.getThreads();
+    o["generations"] = generations;
+    o["seconds"] = seconds;
+    o["generations_per_second"] = generations / seconds;
+    o["cells_per_second"] = generations * (double) size * size / seconds;
+    return o;
+}
+
+
+QJsonObject GameBenchmark::cyclic(int size, int states, int threshold, bool moore) {
+    /* generations per second of worldEvolutionCyclic from random states */
+    CAbase ca(size, size);
+    ca.setCyclic(states, threshold, moore);
+    ca.setThreads(threads);
+    uint64_t seed = 4;
+    for (int k = 1; k <= size; k++) {
+        for (int j = 1; j <= size; j++) {
+            int v = 0;
+            for (int b = 0; b < 8; b++)
+                v = 2 * v + splitmix64Chance(seed, 0.5);
+            ca.setColor(j, k, v % states);
+        }
+    }
+
+    QElapsedTimer t;
+    t.start();
+    qint64 generations = 0;
+    while (generations < 3 || t.nsecsElapsed() < budget * 1e9) {
+        ca.worldEvolutionCyclic();
+        generations++;
+    }
+    double seconds = t.nsecsElapsed() / 1e9;
+
+    QJsonObject o;
+    o["benchmark"] = "worldEvolutionCyclic";
+    o["size"] = size;
+    o["states"] = states;
+    o["threshold"] = threshold;
+    o["neighbourhood"] = moore ? "moore" : "von neumann";
+    o["threads"] = ca.getThreads();
+    o["generations"] = generations;
+    o["seconds"] = seconds;
+    o["generations_per_second"] = generations / seconds;
+    o["cells_per_second"] = generations * (double) size * size / seconds;
+    return o;
+}
+
+
+QJsonObject GameBenchmark::snake(int size) {
+    /* steps per second of CAsnake, short and long snakes: the cycle policy (see CAselfplay.h)
+     * never dies, so the snake grows until it fills the universe or the time is up */
+    CAsnakeGame game(size);
+    CAsnakeCycle policy;
+    game.reset(5);
+    policy.reset(game);
+    const int cells = size * size;
+
+    QElapsedTimer t;
+    t.start();
+    qint64 longSteps = 0;
+    double longStart = 0;
+    while (!game.isOver() && (game.getSteps() < 3 || t.nsecsElapsed() < budget * 1e9)) {
+        game.step(policy.decide(game));
+        if (2 * game.getLength() > cells && longSteps++ == 0)
+            longStart = t.nsecsElapsed() / 1e9;
+    }
+    double seconds = t.nsecsElapsed() / 1e9;
+
+    QJsonObject o;
+    o["benchmark"] = "CAsnake::step";
+    o["size"] = size;
+    o["steps"] = (qint64) game.getSteps();
+    o["length"] = game.getLength();
+    o["won"] = game.getResult() == CAsnake::WON;
+    o["seconds"] = seconds;
+    o["steps_per_second"] = game.getSteps() / seconds;
+    if (longSteps > 1)
+        o["steps_per_second_over_half_full"] = longSteps / (seconds - longStart);
+    return o;
+}
+
+
+QJsonObject GameBenchmark::paint(int size, double density) {
+    /* cost per frame of paintGrid and paintUniverse, rendered offscreen into a QImage */
+    GameWidget w;
+    w.resize(800, 800);
+    w.setUniverseSize(size);
+    w.reconstructGame(randomDump(size, density, 2));
+    w.sync();
+    QImage image(w.size(), QImage::Format_ARGB32_Premultiplied);
+
+    QJsonObject o;
+    o["benchmark"] = "paint";
+    o["size"] = size;
+    o["density"] = density;
+    o["width"] = w.width();
+    o["height"] = w.height();
+
+    /* the whole widget, then the damage of a single edited cell as after a mouse edit */
+    const QRegion full(w.rect());
+    const QRegion cell(w.cellsToWidget(QRect(size / 2, size / 2, 1, 1)));
+    static const char *names[3] = {"paintGrid_ms_per_frame", "paintUniverse_ms_per_frame", "paintEdit_ms_per_frame"};
+    for (int part = 0; part < 3; part++) {
+        QElapsedTimer t;
+        t.start();
+        qint64 frames = 0;
+        while (frames < 3 || t.nsecsElapsed() < budget * 1e9) {
+            image.fill(Qt::white);
+            QPainter p(&image);
+            if (part == 0) w.paint(p, full, GameWidget::GRID);
+            else if (part == 1) w.paint(p, full, GameWidget::UNIVERSE);
+            else {
+                p.setClipRegion(cell);
+                w.paint(p, cell);
+            }
+            frames++;
+        }
+        double ms = t.nsecsElapsed() / 1e6 / frames;
+        o[names[part]] = ms;
+    }
+    return o;
+}
+
+
+QJsonObject GameBenchmark::dump(int size, double density) {
+    /* throughput of dumpGame and reconstructGame (including the hop to the simulation thread) */
+    GameWidget w;
+    w.setUniverseSize(size);
+    w.reconstructGame(randomDump(size, density, 3));
+
+    QElapsedTimer t;
+    t.start();
+    qint64 dumps = 0;
+    QString data;
+    while (dumps < 3 || t.nsecsElapsed() < budget * 1e9) {
+        data = w.dumpGame();
+        dumps++;
+    }
+    double dumpSeconds = t.nsecsElapsed() / 1e9;
+
+    t.restart();
+    qint64 loads = 0;
+    while (loads < 3 || t.nsecsElapsed() < budget * 1e9) {
+        w.reconstructGame(data);
+        w.sync();
+        loads++;
+    }
+    double loadSeconds = t.nsecsElapsed() / 1e9;
+
+    QJsonObject o;
+    o["benchmark"] = "dump";
+    o["size"] = size;
+    o["density"] = density;
+    o["bytes"] = data.size();
+    o["dumpGame_ms"] = dumpSeconds * 1e3 / dumps;
+    o["reconstructGame_ms"] = loadSeconds * 1e3 / loads;
+    o["dumpGame_cells_per_second"] = dumps * (double) size * size / dumpSeconds;
+    o["reconstructGame_cells_per_second"] = loads * (double) size * size / loadSeconds;
+    return o;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption outputOption("o", "Write the JSON results to <file>.", "file");
+    QCommandLineOption sizesOption("sizes", "Comma separated universe sizes.", "sizes", "50,400,2000,10000");
+    QCommandLineOption budgetOption("budget", "Seconds per measurement.", "seconds", "0.5");
+    QCommandLineOption threadsOption("threads", "Threads of the evolutions.", "n", "1");
+    parser.addOption(outputOption);
+    parser.addOption(sizesOption);
+    parser.addOption(budgetOption);
+    parser.addOption(threadsOption);
+    parser.process(app);
+
+    QList<int> sizes;
+    foreach (const QString &s, parser.value(sizesOption).split(',', QString::SkipEmptyParts))
+        sizes.append(s.toInt());
+    int threads = qMax(1, parser.value(threadsOption).toInt());
+    GameBenchmark bench(parser.value(budgetOption).toDouble(), threads);
+
+    QList<double> densities;
+    densities << 0.05 << 0.25 << 0.5;
+
+    QJsonArray results;
+    foreach (int size, sizes) {
+        foreach (double density, densities) {
+            results.append(bench.evolution(size, density, true));
+            results.append(bench.evolution(size, density, false));
+        }
+        results.append(bench.cyclic(size, 3, 3, true));
+        results.append(bench.cyclic(size, 14, 1, false));
+        if (size % 2 == 0 && size <= 2000)
+            results.append(bench.snake(size));
+        results.append(bench.paint(size, 0.25));
+        results.append(bench.dump(size, 0.25));
+    }
+
+    QJsonObject root;
+    root["cpu"] = QSysInfo::currentCpuArchitecture();
+    root["threads"] = threads;
+    root["results"] = results;
+    QByteArray json = QJsonDocument(root).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            QTextStream(stderr) << "could not write " << file.fileName() << "\n";
+            return 1;
+        }
+        file.write(json);
+    }
+    else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
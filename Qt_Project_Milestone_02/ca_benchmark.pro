@@ -0,0 +1,36 @@
+# Microbenchmarks (see benchmark.cpp): the simulation and the widget of the game
+# without the main window. GameWidget and Simulation are QObjects, so their
+# headers go through moc.
+#
+#   qmake ca_benchmark.pro && make
+#   QT_QPA_PLATFORM=offscreen ./ca_benchmark -o results.json
+
+QT += core gui widgets
+
+TARGET = ca_benchmark
+TEMPLATE = app
+CONFIG += console c++11 thread release
+CONFIG -= app_bundle
+
+SOURCES += benchmark.cpp \
+    gamewidget.cpp \
+    simulation.cpp
+
+HEADERS += gamewidget.h \
+    simulation.h \
+    CAbase.h \
+    CAdelta.h \
+    CAfile.h \
+    CAhashlife.h \
+    CAplane.h \
+    CArandom.h \
+    CArecorder.h \
+    CArewind.h \
+    CArule.h \
+    CAselfplay.h \
+    CAsimd.h \
+    CAsnake.h \
+    CAsparse.h \
+    CAstats.h \
+    CAtriplebuffer.h \
+    CAworkers.h
@@ -0,0 +1,150 @@
+/*
+ *  Ensemble runner: many Life runs from random universes over a sweep of sizes and
+ *  densities, on all cores. Every run evolves until the universe is constant or in a cycle
+ *  and reports when that happened and its final and peak population.
+ *
+ *  Needs no Qt, build it for example with
+ *      g++ -O2 -std=c++11 -pthread ensemble.cpp -o ca_ensemble
+ *
+ *  Usage: ca_ensemble [options]
+ *      --sizes <list>      comma separated universe sizes (default: 50,100)
+ *      --densities <list>  comma separated initial densities (default: 0.1,0.2,0.3,0.4,0.5)
+ *      -n <runs>           runs per size and density (default: 100)
+ *      -g <generations>    generations after which a run is stopped (default: 10000)
+ *      -b <rule>           Life-like rule such as B36/S23 (default: B3/S23)
+ *      -t <threads>        number of threads (default: all cores)
+ *      --seed <n>          seed of the sweep, every run gets its own seed from it (default: 1)
+ *      -o <file>           write one CSV line per run as soon as it is finished
+ *
+ *  The summary (one line per size and density, means over the runs) goes to stdout.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CAensemble.h"
+#include "CArule.h"
+
+
+static std::vector<double> splitList(const std::string &text) {
+    std::vector<double> values;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ','))
+        if (!item.empty()) values.push_back(atof(item.c_str()));
+    return values;
+}
+
+
+int main(int argc, char *argv[]) {
+    std::string sizesText = "50,100", densitiesText = "0.1,0.2,0.3,0.4,0.5", output, rule;
+    int runs = 100;
+    int threads = (int) std::max(1u, std::thread::hardware_concurrency());
+    uint64_t maxGenerations = 10000, seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--sizes") && i + 1 < argc) sizesText = argv[++i];
+        else if (!strcmp(argv[i], "--densities") && i + 1 < argc) densitiesText = argv[++i];
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc) runs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-g") && i + 1 < argc) maxGenerations = strtoull(argv[++i], 0, 10);
+        else if (!strcmp(argv[i], "-b") && i + 1 < argc) rule = argv[++i];
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = strtoull(argv[++i], 0, 10);
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) output = argv[++i];
+        else {
+            std::cerr << "usage: " << argv[0] << " [--sizes list] [--densities list] [-n runs]"
+                      << " [-g generations] [-b rule] [-t threads] [--seed n] [-o file.csv]\n";
+            return 2;
+        }
+    }
+
+    std::vector<CAensemble::Task> tasks;
+    std::vector<double> sizes = splitList(sizesText), densities = splitList(densitiesText);
+    for (size_t s = 0; s < sizes.size(); s++) {
+        for (size_t d = 0; d < densities.size(); d++) {
+            CAensemble::Task task;
+            task.size = (int) sizes[s];
+            task.density = densities[d];
+            if (task.size < 1 || task.density < 0 || task.density > 1) {
+                std::cerr << "invalid size " << sizes[s] << " or density " << densities[d] << "\n";
+                return 2;
+            }
+            tasks.push_back(task);
+        }
+    }
+    if (tasks.empty() || runs < 1 || threads < 1) {
+        std::cerr << "sizes, densities, runs and threads must not be empty or 0\n";
+        return 2;
+    }
+
+    CAensemble ensemble(threads);
+    unsigned birth = CAbase::RULE_LIFE_BIRTH, survive = CAbase::RULE_LIFE_SURVIVE;
+    if (!rule.empty()) {
+        if (!CArule::parse(rule, birth, survive)) {
+            std::cerr << "invalid rule " << rule << "\n";
+            return 2;
+        }
+        ensemble.setRule(birth, survive);
+    }
+
+    /* every run is written as soon as it is finished, so a long sweep can be watched */
+    std::ofstream csv;
+    if (!output.empty()) {
+        csv.open(output.c_str());
+        csv << "size,density,run,seed,generations,stable,stable_generation,period,"
+               "population,peak_population,peak_generation\n";
+        if (!csv) {
+            std::cerr << "could not write " << output << "\n";
+            return 1;
+        }
+    }
+    CAensemble::RunCallback done;
+    if (csv.is_open()) {
+        done = [&](const CAensemble::Run &r) {
+            csv << tasks[r.task].size << "," << tasks[r.task].density << "," << r.index << "," << r.seed << ","
+                << r.generations << "," << r.stable << "," << r.stableGeneration << "," << r.period << ","
+                << r.population << "," << r.peakPopulation << "," << r.peakGeneration << "\n";
+        };
+    }
+    const std::vector<CAensemble::Run> &results = ensemble.run(tasks, runs, seed, maxGenerations, done);
+
+    /* summary: means over the runs of every size and density */
+    std::cout << "size density runs stable mean_stable_generation max_stable_generation mean_population"
+                 " mean_peak_population\n";
+    uint64_t generations = 0;
+    for (size_t t = 0; t < tasks.size(); t++) {
+        int stable = 0;
+        uint64_t maxStable = 0;
+        double stableSum = 0, populationSum = 0, peakSum = 0;
+        for (int i = 0; i < runs; i++) {
+            const CAensemble::Run &r = results[t * runs + i];
+            generations += r.generations;
+            if (r.stable) {
+                stable++;
+                stableSum += r.stableGeneration;
+                maxStable = std::max(maxStable, r.stableGeneration);
+            }
+            populationSum += r.population;
+            peakSum += r.peakPopulation;
+        }
+        std::cout << tasks[t].size << " " << tasks[t].density << " " << runs << " " << stable << " "
+                  << (stable ? stableSum / stable : 0) << " " << maxStable << " "
+                  << populationSum / runs << " " << peakSum / runs << "\n";
+    }
+
+    double seconds = ensemble.getSeconds();
+    std::cout << "\nthreads " << threads << "\n"
+              << "rule " << CArule::format(birth, survive) << "\n"
+              << "universes " << results.size() << "\n"
+              << "generations " << generations << "\n"
+              << "seconds " << seconds << "\n"
+              << "universes_per_second " << (seconds > 0 ? results.size() / seconds : 0) << "\n"
+              << "generations_per_second " << (seconds > 0 ? generations / seconds : 0) << "\n";
+    return csv.is_open() && !csv ? 1 : 0;
+}
@@ -1,9 +1,14 @@
+#include <QKeyEvent>
 #include <QMessageBox>
-#include <QTimer>
+#include <QMetaObject>
 #include <QMouseEvent>
+#include <QPaintEvent>
 #include <QDebug>
 #include <QRectF>
 #include <QPainter>
+#include <QThread>
+#include <QTimer>
+#include <QWheelEvent>
 #include "QTime"
 #include <qmath.h>
 #include "gamewidget.h"
@@ -11,54 +16,76 @@
 
 GameWidget::GameWidget(QWidget *parent) :
     QWidget(parent),
-    timer(new QTimer(this)),
-    timerColor(new QTimer(this)),
-    generations(-1),
-    ca1(),
+    simThread(new QThread(this)),
+    sim(new Simulation()),
     universeSize(50),
-    universeMode(0),
-    cellMode(0)
+    interval(300),
+    threads(1),
+    instrumented(false),
+    tracing(false),
+    zoom(1),
+    panning(false),
+    pendingToggle(false),
+    gridStale(true)
     //randomMode(0)
     //lifeTime(50)
 {
-    timer->setInterval(300);
-    timerColor->setInterval(50);
     masterColor = "#000";
-    ca1.resetWorldSize(universeSize, universeSize);
-    connect(timer, SIGNAL(timeout()), this, SLOT(newGeneration()));
-    connect(timerColor, SIGNAL(timeout()), this, SLOT(newGenerationColor()));
 
+    /* the simulation runs on its own thread, finished frames are painted from the triple buffer */
+    qRegisterMetaType<qulonglong>("qulonglong");
+    qRegisterMetaType<QVector<int> >("QVector<int>");
+    sim->moveToThread(simThread);
+    connect(sim, SIGNAL(frameReady(QRegion)), this, SLOT(frameReady(QRegion)));
+    connect(sim, SIGNAL(universeConstant()), this, SLOT(universeConstant()));
+    connect(sim, SIGNAL(universeCycle(qulonglong, int)), this, SLOT(universeCycle(qulonglong, int)));
+    connect(sim, SIGNAL(iterationsFinished()), this, SLOT(iterationsFinished()));
+    connect(sim, SIGNAL(snakeEnded(bool, int)), this, SLOT(snakeEnded(bool, int)));
+    connect(sim, SIGNAL(generationRate(double)), this, SIGNAL(generationRate(double)));
+    connect(sim, SIGNAL(statistics(QString)), this, SLOT(simStatistics(QString)));
+    connect(sim, SIGNAL(rewindRange(qulonglong, qulonglong, qulonglong)),
+            this, SIGNAL(rewindRange(qulonglong, qulonglong, qulonglong)));
+    simThread->start();
+    setFocusPolicy(Qt::StrongFocus); // keys for the snake
 }
 
 
 GameWidget::~GameWidget() {
+    QMetaObject::invokeMethod(sim, "stopGame", Qt::BlockingQueuedConnection);
+    simThread->quit();
+    simThread->wait();
+    delete sim;
+}
+
+
+void GameWidget::sync() {
+    /* wait until the simulation has done all calls made so far */
+    QMetaObject::invokeMethod(sim, "sync", Qt::BlockingQueuedConnection);
 }
 
 
 void GameWidget::startGame(const int &number) {
     /* start the game */
-    generations = number;
-    timer->start();
+    QMetaObject::invokeMethod(sim, "startGame", Qt::QueuedConnection, Q_ARG(int, number));
 }
 
 
 void GameWidget::stopGame() {
     /* stop the game */
-    timer->stop();
-    timerColor->stop();
+    QMetaObject::invokeMethod(sim, "stopGame", Qt::QueuedConnection);
+}
+
+
+void GameWidget::jumpGame(const int &number) {
+    /* jump number generations ahead with HashLife, done on the simulation thread */
+    QMetaObject::invokeMethod(sim, "jumpGame", Qt::QueuedConnection, Q_ARG(int, number));
 }
 
 
 void GameWidget::clearGame() {
-    for (int k = 1; k <= universeSize; k++) {
-        for (int j = 1; j <= universeSize; j++) {
-            ca1.setAlive(j, k, 0);
-        }
-    }
+    QMetaObject::invokeMethod(sim, "clearGame", Qt::QueuedConnection);
     gameEnds(true);
-    ca1.resetWorldSize(universeSize, universeSize);
     //randomMode = 0;
-    update();
 }
 
 
@@ -70,8 +97,8 @@ int GameWidget::getUniverseSize() {
 void GameWidget::setUniverseSize(const int &s) {
     /* set number of the cells in one row */
     universeSize = s;
-    ca1.resetWorldSize(s, s);
-    update();
+    setView(1, QPointF());
+    QMetaObject::invokeMethod(sim, "setUniverseSize", Qt::QueuedConnection, Q_ARG(int, s));
 }
 
 
@@ -89,197 +116,485 @@ void GameWidget::setUniverseSize(const int &s) {
 
 void GameWidget::setUniverseMode(const int &m) {
     /* set universe mode */
-    universeMode = m;
+    QMetaObject::invokeMethod(sim, "setUniverseMode", Qt::QueuedConnection, Q_ARG(int, m));
+}
+
+
+bool GameWidget::setRule(const QString &rule) {
+    /* rule of the Life universe, the rulestring is checked by the simulation */
+    bool ok = false;
+    QMetaObject::invokeMethod(sim, "setRule", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, ok), Q_ARG(QString, rule));
+    return ok;
 }
 
 
 void GameWidget::setCellMode(const int &m) {
     /* set cell mode */
-    cellMode = m;
+    QMetaObject::invokeMethod(sim, "setCellMode", Qt::QueuedConnection, Q_ARG(int, m));
+}
+
+
+void GameWidget::setCyclic(int states, int threshold, bool moore) {
+    /* states and threshold of the cyclic CA, Moore (eight) or von Neumann (four) neighbours */
+    QMetaObject::invokeMethod(sim, "setCyclic", Qt::QueuedConnection,
+                              Q_ARG(int, states), Q_ARG(int, threshold), Q_ARG(bool, moore));
+}
+
+
+void GameWidget::setBoundary(int b) {
+    /* torus, dead wall or mirror */
+    QMetaObject::invokeMethod(sim, "setBoundary", Qt::QueuedConnection, Q_ARG(int, b));
 }
 
 
 QString GameWidget::dumpGame() {
-    /* dump current universe */
-    char temp;
-    QString master = "";
-    for (int k = 1; k <= universeSize; k++) {
-        for (int j = 1; j <= universeSize; j++) {
-            if (ca1.isAlive(j, k) == 1) {
-                temp = '*';
-            } else {
-                temp = 'o';
-            }
-            master.append(temp);
-        }
-        master.append("\n");
-    }
+    /* dump current universe, waits for the generation in progress */
+    QString master;
+    QMetaObject::invokeMethod(sim, "dumpGame", Qt::BlockingQueuedConnection, Q_RETURN_ARG(QString, master));
     return master;
 }
 
 
 void GameWidget::reconstructGame(const QString &data) {
      // reconstruct game from dump
-    int current = 0;
-    for (int k = 1; k <= universeSize; k++) {
-        for (int j = 1; j <= universeSize; j++) {
-           if (data[current] == '*') ca1.setAlive(j, k, 1);
-            current++;
-        }
-        current++;
+    QMetaObject::invokeMethod(sim, "reconstructGame", Qt::QueuedConnection, Q_ARG(QString, data));
+}
+
+
+bool GameWidget::saveGame(const QString &filename) {
+    /* the simulation writes the file itself, no dump string in between */
+    bool ok = false;
+    QMetaObject::invokeMethod(sim, "saveGame", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, ok), Q_ARG(QString, filename));
+    return ok;
+}
+
+
+bool GameWidget::loadGame(const QString &filename) {
+    /* the simulation reads the file straight into the universe */
+    bool ok = false;
+    QMetaObject::invokeMethod(sim, "loadGame", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, ok), Q_ARG(QString, filename));
+    return ok;
+}
+
+
+bool GameWidget::startRecording(const QString &filename) {
+    bool ok = false;
+    QMetaObject::invokeMethod(sim, "startRecording", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, ok), Q_ARG(QString, filename));
+    return ok;
+}
+
+
+void GameWidget::stopRecording() {
+    QMetaObject::invokeMethod(sim, "stopRecording", Qt::QueuedConnection);
+}
+
+
+qlonglong GameWidget::openRecording(const QString &filename) {
+    qlonglong last = -1;
+    QMetaObject::invokeMethod(sim, "openRecording", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(qlonglong, last), Q_ARG(QString, filename));
+    return last;
+}
+
+
+bool GameWidget::seekRecording(qlonglong generation) {
+    /* the recorded universe may have another size than the current one */
+    int size = 0;
+    QMetaObject::invokeMethod(sim, "seekRecording", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(int, size), Q_ARG(qlonglong, generation));
+    if (size > 0 && size != universeSize) {
+        universeSize = size;
+        setView(1, QPointF());
     }
-    update();
+    return size > 0;
+}
+
+
+void GameWidget::stepBack() {
+    /* the last generations are kept as deltas, going back only flips the changed cells */
+    QMetaObject::invokeMethod(sim, "stepBack", Qt::QueuedConnection);
+}
+
+
+void GameWidget::rewindTo(int generation) {
+    QMetaObject::invokeMethod(sim, "rewindTo", Qt::QueuedConnection, Q_ARG(qlonglong, generation));
+}
+
+
+void GameWidget::setRewindMemory(int megabytes) {
+    QMetaObject::invokeMethod(sim, "setRewindMemory", Qt::QueuedConnection, Q_ARG(int, megabytes));
+}
+
+
+void GameWidget::setInstrumentation(bool on) {
+    instrumented = on;
+    paintStats.clear();
+    QMetaObject::invokeMethod(sim, "setInstrumentation", Qt::QueuedConnection, Q_ARG(bool, on));
+}
+
+
+bool GameWidget::startStatsLog(const QString &filename) {
+    bool ok = false;
+    QMetaObject::invokeMethod(sim, "startStatsLog", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, ok), Q_ARG(QString, filename));
+    return ok;
+}
+
+
+void GameWidget::stopStatsLog() {
+    QMetaObject::invokeMethod(sim, "stopStatsLog", Qt::QueuedConnection);
+}
+
+
+bool GameWidget::startTrace(const QString &filename) {
+    /* the simulation opens the trace, the paint events go into the same file */
+    bool ok = false;
+    QMetaObject::invokeMethod(sim, "startTrace", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, ok), Q_ARG(QString, filename));
+    tracing = ok;
+    return ok;
+}
+
+
+void GameWidget::stopTrace() {
+    tracing = false;
+    QMetaObject::invokeMethod(sim, "stopTrace", Qt::BlockingQueuedConnection);
+}
+
+
+void GameWidget::simStatistics(const QString &text) {
+    /* the readout of the simulation with the painting times of this thread */
+    emit statistics(text + "\n" + Simulation::phaseText(paintStats, CAstats::PAINT_GRID)
+                    + "\n" + Simulation::phaseText(paintStats, CAstats::PAINT_UNIVERSE));
 }
 
 
 int GameWidget::getInterval() {
     /* interval between generations */
-    return timer->interval();
+    return interval;
 }
 
 
 void GameWidget::setInterval(int msec) {
     /* set interval between generations */
-    timer->setInterval(msec);
+    interval = msec;
+    QMetaObject::invokeMethod(sim, "setInterval", Qt::QueuedConnection, Q_ARG(int, msec));
 }
 
 
-void GameWidget::newGeneration() {
-    /* start the evolution of universe and update the game field */
-    if (generations < 0)
-        generations++;
+void GameWidget::setTurbo(bool on) {
+    /* turbo: the simulation runs generations back to back and publishes a frame at a fixed rate */
+    QMetaObject::invokeMethod(sim, "setTurbo", Qt::QueuedConnection, Q_ARG(bool, on));
+}
+
+
+void GameWidget::setTurboRate(int gensPerSecond) {
+    /* target generations per second in turbo mode, 0 = as fast as possible */
+    QMetaObject::invokeMethod(sim, "setTurboRate", Qt::QueuedConnection, Q_ARG(int, gensPerSecond));
+}
+
+
+int GameWidget::getThreads() {
+    /* number of threads for the evolution */
+    return threads;
+}
 
-    ca1.worldEvolutionLife();
-    update();
 
-    if (ca1.isNotChanged()) {
-        QMessageBox::information(this,
-                                 tr("Game lost sense"),
-                                 tr("The End. Now game finished because all the next generations will be the same."),
-                                 QMessageBox::Ok);
-        stopGame();
-        gameEnds(true);
+void GameWidget::setThreads(int n) {
+    /* set number of threads for the evolution, the universe is split into bands of tiles */
+    threads = n;
+    QMetaObject::invokeMethod(sim, "setThreads", Qt::QueuedConnection, Q_ARG(int, n));
+}
+
+
+void GameWidget::universeConstant() {
+    QMessageBox::information(this,
+                             tr("Game lost sense"),
+                             tr("The End. Now game finished because all the next generations will be the same."),
+                             QMessageBox::Ok);
+    gameEnds(true);
+}
+
+
+void GameWidget::universeCycle(qulonglong start, int period) {
+    /* the universe is in a cycle (oscillators, gliders on the torus), it will never end by itself */
+    QMessageBox::information(this,
+                             tr("Game lost sense"),
+                             tr("The End. Since generation %1 the universe repeats itself every %2 generations.")
+                             .arg(start)
+                             .arg(period),
+                             QMessageBox::Ok);
+    gameEnds(true);
+}
+
+
+void GameWidget::iterationsFinished() {
+    gameEnds(true);
+    QMessageBox::information(this,
+                             tr("Game finished."),
+                             tr("Iterations finished."),
+                             QMessageBox::Ok,
+                             QMessageBox::Cancel);
+}
+
+
+void GameWidget::snakeEnded(bool won, int length) {
+    QMessageBox::information(this,
+                             tr("Game over"),
+                             won ? tr("The snake fills the whole universe. You won with length %1.").arg(length)
+                                 : tr("The snake crashed at length %1.").arg(length),
+                             QMessageBox::Ok);
+    gameEnds(true);
+}
+
+
+void GameWidget::frameReady(const QRegion &changed) {
+    /* only the changed cells are repainted, Qt merges the updates until the next paint event */
+    if (changed.boundingRect() == QRect(0, 0, universeSize, universeSize)) {
+        update();
         return;
     }
-
-    generations--;
-    if (generations == 0) {
-        stopGame();
-        gameEnds(true);
-        QMessageBox::information(this,
-                                 tr("Game finished."),
-                                 tr("Iterations finished."),
-                                 QMessageBox::Ok,
-                                 QMessageBox::Cancel);
+    if (changed.rectCount() > 64) {
+        update(cellsToWidget(changed.boundingRect())); // scattered changes, one rectangle is cheaper
+        return;
     }
+    for (QRegion::const_iterator r = changed.begin(); r != changed.end(); ++r)
+        update(cellsToWidget(*r));
+}
+
+
+QRect GameWidget::cellsToWidget(const QRect &cells) {
+    /* pixels of the cells (x - 1, y - 1) in the view, one more on every side for the grid lines */
+    int x0 = floor((cells.left() - viewOrigin.x()) * cellWidth()) - 1;
+    int y0 = floor((cells.top() - viewOrigin.y()) * cellHeight()) - 1;
+    int x1 = ceil((cells.right() + 1 - viewOrigin.x()) * cellWidth()) + 1;
+    int y1 = ceil((cells.bottom() + 1 - viewOrigin.y()) * cellHeight()) + 1;
+    return QRect(x0, y0, x1 - x0, y1 - y0).intersected(rect());
 }
 
 
-void GameWidget::newGenerationColor() {
-    /* Start the evolution of universe and update the game field for "Cyclic cellular automata" mode */
-    if (generations < 0)
-        generations++;
+double GameWidget::cellWidth() {
+    return (double) width()/universeSize * zoom;
+}
+
+
+double GameWidget::cellHeight() {
+    return (double) height()/universeSize * zoom;
+}
+
 
+double GameWidget::maxZoom() {
+    /* at least four cells stay in the view */
+    return qMax(1.0, universeSize / 4.0);
+}
+
+
+void GameWidget::setView(double z, const QPointF &origin) {
+    /* the view never leaves the universe */
+    zoom = qBound(1.0, z, maxZoom());
+    double visible = universeSize / zoom; // cells in one row of the view
+    viewOrigin = QPointF(qBound(0.0, origin.x(), universeSize - visible),
+                         qBound(0.0, origin.y(), universeSize - visible));
+    gridStale = true;
     update();
+}
 
-    generations--;
-    if (generations == 0) {
-        stopGame();
-        gameEnds(true);
-        QMessageBox::information(this,
-                                 tr("Game finished."),
-                                 tr("Iterations finished."),
-                                 QMessageBox::Ok,
-                                 QMessageBox::Cancel);
-    }
+
+void GameWidget::paint(QPainter &p, const QRegion &region, int layers) {
+    /* paint without a paint event, the benchmark paints into an image */
+    if (layers & GRID)
+        paintGrid(p, region);
+    if (layers & UNIVERSE)
+        paintUniverse(p, region);
 }
 
 
-void GameWidget::paintEvent(QPaintEvent *) {
+void GameWidget::paintEvent(QPaintEvent *e) {
     QPainter p(this);
-    paintGrid(p);
-    paintUniverse(p);
+    if (!instrumented && !tracing) {
+        paintGrid(p, e->region());
+        paintUniverse(p, e->region());
+        return;
+    }
+
+    /* the same painting, timed */
+    int64_t start = CAstats::now();
+    paintGrid(p, e->region());
+    int64_t middle = CAstats::now();
+    paintUniverse(p, e->region());
+    int64_t end = CAstats::now();
+    paintStats.add(CAstats::PAINT_GRID, middle - start);
+    paintStats.add(CAstats::PAINT_UNIVERSE, end - middle);
+    if (tracing) {
+        sim->getTrace()->event("paint grid", CAtrace::GUI, start, middle - start);
+        sim->getTrace()->event("paint universe", CAtrace::GUI, middle, end - middle);
+    }
+}
+
+
+QPoint GameWidget::cellAt(const QPoint &pos) {
+    return QPoint(floor(viewOrigin.x() + pos.x()/cellWidth()) + 1, floor(viewOrigin.y() + pos.y()/cellHeight()) + 1);
 }
 
 
 void GameWidget::mousePressEvent(QMouseEvent *e) {
+    if (e->button() == Qt::RightButton || e->button() == Qt::MiddleButton) {
+        panning = true;
+        panStart = e->pos();
+        panOrigin = viewOrigin;
+        return;
+    }
+    if (e->button() != Qt::LeftButton)
+        return;
     emit environmentChanged(true);
-    double cellWidth = (double) width()/universeSize;
-    double cellHeight = (double) height()/universeSize;
-    int k = floor(e->y()/cellHeight) + 1;
-    int j = floor(e->x()/cellWidth) + 1;
+    lastCell = cellAt(e->pos());
+    strokeTo(lastCell, true);
+}
 
-    int mode[9] = {1, 3, 6, 4, 2, 8, 9, 10, 11};
 
-    if (ca1.isAlive(j, k) != 0) {
-        ca1.setAlive(j, k, 0);
-        ca1.setLife(j, k, 0);
+void GameWidget::mouseMoveEvent(QMouseEvent *e)
+{
+    if (panning) {
+        /* the cell under the mouse stays under it */
+        setView(zoom, panOrigin - QPointF((e->x() - panStart.x())/cellWidth(), (e->y() - panStart.y())/cellHeight()));
+        return;
     }
-    else {
-        ca1.setAlive(j, k, mode[cellMode]);
-        if (mode[cellMode] == 9 || mode[cellMode] == 10)
-            ca1.setLife(j, k, 50); // lifeTime = 50
+    if (!(e->buttons() & Qt::LeftButton))
+        return;
+
+    /* every cell on the line from the last one, so fast drags leave no gaps (Bresenham) */
+    QPoint cell = cellAt(e->pos());
+    int dx = qAbs(cell.x() - lastCell.x()), sx = cell.x() > lastCell.x() ? 1 : -1;
+    int dy = -qAbs(cell.y() - lastCell.y()), sy = cell.y() > lastCell.y() ? 1 : -1;
+    int error = dx + dy;
+    QPoint c = lastCell;
+    while (c != cell) {
+        int e2 = 2 * error;
+        if (e2 >= dy) {
+            error += dy;
+            c.rx() += sx;
+        }
+        if (e2 <= dx) {
+            error += dx;
+            c.ry() += sy;
+        }
+        strokeTo(c, false);
     }
+    lastCell = cell;
+}
 
-    update();
+
+void GameWidget::mouseReleaseEvent(QMouseEvent *e) {
+    if (e->button() == Qt::RightButton || e->button() == Qt::MiddleButton)
+        panning = false;
 }
 
 
-void GameWidget::mouseMoveEvent(QMouseEvent *e)
-{
-    double cellWidth = (double) width()/universeSize;
-    double cellHeight = (double) height()/universeSize;
-    int k = floor(e->y()/cellHeight)+1;
-    int j = floor(e->x()/cellWidth)+1;
+void GameWidget::wheelEvent(QWheelEvent *e) {
+    /* one notch zooms by a fifth, the cell under the mouse stays under it */
+    QPointF under(viewOrigin.x() + e->pos().x()/cellWidth(), viewOrigin.y() + e->pos().y()/cellHeight());
+    zoom = qBound(1.0, zoom * pow(1.2, e->angleDelta().y() / 120.0), maxZoom());
+    setView(zoom, QPointF(under.x() - e->pos().x()/cellWidth(), under.y() - e->pos().y()/cellHeight()));
+    e->accept();
+}
 
-    int mode[9] = {1, 3, 6, 4, 2, 8, 9, 10, 11};
 
-    if(ca1.isAlive(j, k) == 0){
-        ca1.setAlive(j, k, mode[cellMode]);
-        if (mode[cellMode] == 9 || mode[cellMode] == 10)
-            ca1.setLife(j, k, 50); // lifetime = 50
-        update();
+void GameWidget::strokeTo(const QPoint &cell, bool toggle) {
+    /* the edits are collected and queued into the simulation thread at once, which publishes one frame */
+    if (!pendingEdits.isEmpty() && toggle != pendingToggle)
+        flushEdits();
+    if (pendingEdits.isEmpty())
+        QTimer::singleShot(0, this, SLOT(flushEdits()));
+    pendingToggle = toggle;
+    pendingEdits << cell.x() << cell.y();
+}
+
+
+void GameWidget::flushEdits() {
+    if (pendingEdits.isEmpty())
+        return;
+    QMetaObject::invokeMethod(sim, "editCells", Qt::QueuedConnection,
+                              Q_ARG(QVector<int>, pendingEdits), Q_ARG(bool, pendingToggle));
+    pendingEdits.clear();
+}
+
+
+void GameWidget::keyPressEvent(QKeyEvent *e) {
+    /* the direction is queued into the simulation thread, only the "Snake" mode uses it */
+    int direction;
+    switch (e->key()) {
+    case Qt::Key_W: case Qt::Key_Up: direction = CAsnake::UP; break;
+    case Qt::Key_D: case Qt::Key_Right: direction = CAsnake::RIGHT; break;
+    case Qt::Key_S: case Qt::Key_Down: direction = CAsnake::DOWN; break;
+    case Qt::Key_A: case Qt::Key_Left: direction = CAsnake::LEFT; break;
+    default:
+        QWidget::keyPressEvent(e);
+        return;
     }
+    QMetaObject::invokeMethod(sim, "turnSnake", Qt::QueuedConnection, Q_ARG(int, direction));
 }
 
 
-void GameWidget::paintGrid(QPainter &p) {
-    QRect borders(0, 0, width() - 1, height() - 1); // borders of the universe
-    QColor gridColor = masterColor; // color of the grid
-    gridColor.setAlpha(10); // must be lighter than main color
-    p.setPen(gridColor);
-    double cellWidth = (double) width()/universeSize; // width of the widget / number of cells at one row
-    for (double k = cellWidth; k <= width(); k += cellWidth)
-        p.drawLine(k, 0, k, height());
-    double cellHeight = (double) height()/universeSize; // height of the widget / number of cells at one row
-    for (double k = cellHeight; k <= height(); k += cellHeight)
-        p.drawLine(0, k, width(), k);
-    p.drawRect(borders);
-}
-
-
-void GameWidget::paintUniverse(QPainter &p) {
-    double cellWidth = (double) width()/universeSize;
-    double cellHeight = (double) height()/universeSize;
-    for (int k=1; k <= universeSize; k++) {
-        for (int j=1; j <= universeSize; j++) {
-            if (ca1.isAlive(j, k) != 0) {
-                qreal left = (qreal) (cellWidth * j - cellWidth); // margin from left
-                qreal top  = (qreal) (cellHeight * k - cellHeight); // margin from top
-                QRectF r(left, top, (qreal) cellWidth, (qreal) cellHeight);
-                if (0 && universeMode != 7) { // randomMode = 0
-                    p.fillRect(r, setColor(ca1.getColor(j, k))); //fill cell with brush from random mode
-                 }
-                else {
-                    if (ca1.isAlive(j, k) == 1 || universeMode == 7) {
-                        p.fillRect(r, QBrush(masterColor)); // fill cell with brush of main color
-                    }
-                    else {
-                        p.fillRect(r, setColor(ca1.isAlive(j, k))); //fill cell with brush of cell type
-                    }
-                }
-            }
+void GameWidget::paintGrid(QPainter &p, const QRegion &region) {
+    /* the grid only changes with the widget size, the universe size, the view and the color, so it is drawn once into a pixmap */
+    if (gridStale || gridPixmap.size() != size()) {
+        gridPixmap = QPixmap(size());
+        gridPixmap.fill(Qt::transparent);
+        QPainter gp(&gridPixmap);
+        QColor gridColor = masterColor; // color of the grid
+        gridColor.setAlpha(10); // must be lighter than main color
+        gp.setPen(gridColor);
+        double cellWidth = this->cellWidth(); // pixels per cell at the zoom of the view
+        double cellHeight = this->cellHeight();
+        /* only the lines in the view; below three pixels per cell they would cover the cells */
+        if (cellWidth >= 3 && cellHeight >= 3) {
+            for (double k = (floor(viewOrigin.x()) + 1 - viewOrigin.x()) * cellWidth; k <= width(); k += cellWidth)
+                gp.drawLine(k, 0, k, height());
+            for (double k = (floor(viewOrigin.y()) + 1 - viewOrigin.y()) * cellHeight; k <= height(); k += cellHeight)
+                gp.drawLine(0, k, width(), k);
         }
+        QRect borders(qRound(-viewOrigin.x() * cellWidth), qRound(-viewOrigin.y() * cellHeight),
+                      qRound(universeSize * cellWidth) - 1, qRound(universeSize * cellHeight) - 1); // borders of the universe
+        gp.drawRect(borders);
+        gridStale = false;
+    }
+    for (QRegion::const_iterator r = region.begin(); r != region.end(); ++r)
+        p.drawPixmap(*r, gridPixmap, *r);
+}
+
+
+void GameWidget::paintUniverse(QPainter &p, const QRegion &region) {
+    /* latest complete frame of the simulation, only the cells in the view and under the region
+       (the painter clips to it); when several cells share a pixel, the level of detail with
+       about one pixel per pixel is drawn, so the cost depends on the widget and not on the universe */
+    const Simulation::Frame &frame = sim->latestFrame();
+    if (frame.empty())
+        return;
+    double cellsPerPixel = qMax(frame[0].width() / (width() * zoom), frame[0].height() / (height() * zoom));
+    size_t level = 0;
+    while (level + 1 < frame.size() && (2 << level) <= cellsPerPixel)
+        level++;
+    const QImage &image = frame[level];
+    const int cells = 1 << level; // cells in one row of a pixel of the image
+
+    /* pixels of the widget per pixel of the image, and the view in pixels of the image */
+    double pixelWidth = (double) width()/frame[0].width() * zoom * cells;
+    double pixelHeight = (double) height()/frame[0].height() * zoom * cells;
+    double originX = viewOrigin.x() / cells, originY = viewOrigin.y() / cells;
+    for (QRegion::const_iterator r = region.begin(); r != region.end(); ++r) {
+        int x0 = qMax(0, (int) floor(originX + r->left() / pixelWidth));
+        int y0 = qMax(0, (int) floor(originY + r->top() / pixelHeight));
+        int x1 = qMin(image.width(), (int) ceil(originX + (r->right() + 1) / pixelWidth));
+        int y1 = qMin(image.height(), (int) ceil(originY + (r->bottom() + 1) / pixelHeight));
+        if (x0 >= x1 || y0 >= y1)
+            continue;
+        QRectF target((x0 - originX) * pixelWidth, (y0 - originY) * pixelHeight,
+                      (x1 - x0) * pixelWidth, (y1 - y0) * pixelHeight);
+        p.drawImage(target, image, QRectF(x0, y0, x1 - x0, y1 - y0));
     }
 }
 
@@ -291,27 +606,12 @@ QColor GameWidget::getMasterColor() {
 
 void GameWidget::setMasterColor(const QColor &color) {
     masterColor = color;
+    gridStale = true;
+    QMetaObject::invokeMethod(sim, "setMasterColor", Qt::QueuedConnection, Q_ARG(QColor, color));
     update();
 }
 
 
 QColor GameWidget::setColor(const int &color) {
-    QColor cellColor[12]= {Qt::red,
-                           Qt::darkRed,
-                           Qt::green,
-                           Qt::darkGreen,
-                           Qt::blue,
-                           Qt::darkBlue,
-                           Qt::cyan,
-                           Qt::darkCyan,
-                           Qt::magenta,
-                           Qt::darkMagenta,
-                           Qt::yellow,
-                           Qt::darkYellow};
-
-//    if (color >= 0 && color < 12)
-//        cellColor[color];
-
-    return cellColor[color];
+    return Simulation::typeColor(color);
 }
-
@@ -2,8 +2,16 @@
 #define GAMEWIDGET_H
 
 #include <QColor>
+#include <QPixmap>
+#include <QPoint>
+#include <QPointF>
+#include <QRegion>
+#include <QVector>
 #include <QWidget>
-#include "CAbase.h"
+#include "simulation.h"
+
+class QPainter;
+class QThread;
 
 
 class GameWidget : public QWidget {
@@ -11,34 +19,61 @@ class GameWidget : public QWidget {
     Q_OBJECT
 
 public:
+    enum Layer { GRID = 1, UNIVERSE = 2 };
+
     explicit GameWidget(QWidget *parent = 0);
     ~GameWidget();
 
+    void sync(); // wait until the simulation has done all calls made so far
+
+    // what paintEvent draws, into any painter, e.g. of an image; region in widget pixels
+    void paint(QPainter &p, const QRegion &region, int layers = GRID | UNIVERSE);
+    QRect cellsToWidget(const QRect &cells); // widget pixels of the cells (x - 1, y - 1)
+
 protected:
     void paintEvent(QPaintEvent *);
     void mousePressEvent(QMouseEvent *e);
     void mouseMoveEvent(QMouseEvent *e);
+    void mouseReleaseEvent(QMouseEvent *e);
+    void wheelEvent(QWheelEvent *e); // zoom around the mouse
+    void keyPressEvent(QKeyEvent *e); // W A S D or the arrows steer the snake
 
 signals:
     // when one of the cell has been changed,emit this signal to lock the universeSize
     void environmentChanged(bool ok);
     // when game is over or clear is called,emit it to unlock the universeSize
     void gameEnds(bool ok);
+    // generations per second of the running game, 0 when it stops
+    void generationRate(double gensPerSecond);
+    // generations that can be rewound to, and the one on the field
+    void rewindRange(qulonglong oldest, qulonglong newest, qulonglong current);
+    // instrumentation readout of the simulation and the painting, about twice a second
+    void statistics(const QString &text);
 
 public slots:
     void startGame(const int &number = -1); // start
     void stopGame(); // finish
+    void jumpGame(const int &number); // jump number generations ahead at once
     void clearGame(); // clear
 
     int getUniverseSize(); // number of the cells in one row
     void setUniverseSize(const int &s); // set number of the cells in one row
 
     void setUniverseMode(const int &m); //set evolution mode
+    bool setRule(const QString &rule); // Life-like rulestring such as "B36/S23", false if invalid
     void setCellMode(const int &m); //set cell mode
+    void setCyclic(int states, int threshold, bool moore); // parameters of the "Cyclic CA" mode
+    void setBoundary(int b); // edges of the universe, CAbase::Boundary
 
     int getInterval(); // interval between generations
     void setInterval(int msec); // set interval between generations
 
+    void setTurbo(bool on); // fast-forward: as many generations per frame as fit in
+    void setTurboRate(int gensPerSecond); // target for turbo mode, 0 = as fast as possible
+
+    int getThreads(); // number of threads for the evolution
+    void setThreads(int n); // set number of threads for the evolution
+
     //int getLifeInterval(); // cell's lifetime - number of step when cell is on the universe
     //void setLifeInterval(const int &l); // set lifetime for cell
 
@@ -48,22 +83,73 @@ public slots:
 
     QString dumpGame(); // dump of current universe
     void reconstructGame(const QString &data); // set current universe from it's dump
+    bool saveGame(const QString &filename); // save in the binary format (Life RLE for *.rle)
+    bool loadGame(const QString &filename); // load a binary save or a Life RLE pattern
+
+    bool startRecording(const QString &filename); // record the run as trajectory file
+    void stopRecording();
+    qlonglong openRecording(const QString &filename); // last generation of the recording, -1 on error
+    bool seekRecording(qlonglong generation); // show a generation of the opened recording
+
+    void stepBack(); // one generation back
+    void rewindTo(int generation); // any generation still in the rewind buffer
+    void setRewindMemory(int megabytes); // memory for the rewind buffer, 0 = off
+
+    void setInstrumentation(bool on); // time evolution, rendering and painting
+    bool startStatsLog(const QString &filename); // CSV line per generation
+    void stopStatsLog();
+    bool startTrace(const QString &filename); // Chrome trace of simulation and painting
+    void stopTrace();
 
 private slots:
-    void paintGrid(QPainter &p);
-    void paintUniverse(QPainter &p);
-    void newGeneration();
-    void newGenerationColor();
+    void paintGrid(QPainter &p, const QRegion &region); // region in widget pixels
+    void paintUniverse(QPainter &p, const QRegion &region);
+    void frameReady(const QRegion &changed); // repaint the changed cells
+    void flushEdits();
+    void universeConstant();
+    void universeCycle(qulonglong start, int period);
+    void iterationsFinished();
+    void simStatistics(const QString &text);
+    void snakeEnded(bool won, int length);
 
 private:
+    // the universe lives in sim, which runs on its own thread; all calls to it are queued
+    QThread *simThread;
+    Simulation *sim;
+
     QColor masterColor;
-    QTimer *timer;
-    QTimer *timerColor;
-    int generations;
-    CAbase ca1;
     int universeSize;
-    int universeMode;
-    int cellMode;
+    int interval;
+    int threads;
+
+    // painting times for the instrumentation; the trace is the one of the simulation
+    bool instrumented;
+    bool tracing;
+    CAstats paintStats;
+
+    // viewport: zoom 1 shows the whole universe, viewOrigin is the cell position (from 0)
+    // at the top left corner; the right or middle button drags it
+    double cellWidth(); // pixels per cell
+    double cellHeight();
+    double maxZoom();
+    void setView(double z, const QPointF &origin);
+    double zoom;
+    QPointF viewOrigin;
+    bool panning;
+    QPoint panStart;
+    QPointF panOrigin;
+
+    // mouse edits: a drag is drawn as a line from the last cell, the cells of all events
+    // until the event loop is idle again go to the simulation as one edit (one frame)
+    QPoint cellAt(const QPoint &pos);
+    void strokeTo(const QPoint &cell, bool toggle);
+    QPoint lastCell;
+    QVector<int> pendingEdits;
+    bool pendingToggle;
+
+    // grid lines are cached
+    QPixmap gridPixmap;
+    bool gridStale;
 
     //int randomMode;
     //int lifeTime;
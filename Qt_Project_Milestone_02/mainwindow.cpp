@@ -1,13 +1,19 @@
 #include <QTextStream>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QDebug>
 #include <QColor>
 #include <QMessageBox>
 #include <QColorDialog>
+#include <QInputDialog>
+#include <climits>
 #include <ctime>
+#include <fstream>
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "CAfile.h"
+#include "CArule.h"
 
 
 MainWindow::MainWindow(QWidget *parent) :
@@ -18,13 +24,29 @@ MainWindow::MainWindow(QWidget *parent) :
 {
     ui->setupUi(this);
 
-    /* game choices */
-    ui->universeModeControl->addItem("Classic Life");
+    /* game choices, the Life-like rules after the three games; the item data is the rule */
+    ui->universeModeControl->addItem("Classic Life", "B3/S23");
     ui->universeModeControl->addItem("Snake");
+    ui->universeModeControl->addItem("Unbounded Life", "B3/S23");
+    ui->universeModeControl->addItem("Cyclic CA");
+    int count;
+    const CArule::Preset *presets = CArule::presets(count);
+    for (int i = 1; i < count; i++)
+        ui->universeModeControl->addItem(QString("%1 (%2)").arg(presets[i].name).arg(presets[i].rule), presets[i].rule);
+    ui->universeModeControl->addItem(tr("Custom Rule..."), "B3/S23");
 
     /*cell mode choices*/
     ui->cellModeControl->addItem("Classic");
 
+    /* neighbourhoods of the cyclic CA */
+    ui->cyclicNeighbourhoodControl->addItem("Moore");
+    ui->cyclicNeighbourhoodControl->addItem("von Neumann");
+
+    /* edges of the universe, in the order of CAbase::Boundary */
+    ui->boundaryControl->addItem("Torus");
+    ui->boundaryControl->addItem("Dead Wall");
+    ui->boundaryControl->addItem("Mirror");
+
     /* color icons for color buttons */
     QPixmap icon(16, 16);
     icon.fill(currentColor);
@@ -40,10 +62,21 @@ MainWindow::MainWindow(QWidget *parent) :
     // spin boxes
     connect(ui->intervalControl, SIGNAL(valueChanged(int)), game, SLOT(setInterval(int)));
     connect(ui->universeSizeControl, SIGNAL(valueChanged(int)), game, SLOT(setUniverseSize(int)));
+    connect(ui->threadsControl, SIGNAL(valueChanged(int)), game, SLOT(setThreads(int)));
+    connect(ui->turboRateControl, SIGNAL(valueChanged(int)), game, SLOT(setTurboRate(int)));
+
+    // turbo mode and its generations per second readout
+    connect(ui->turboControl, SIGNAL(toggled(bool)), game, SLOT(setTurbo(bool)));
+    connect(game, SIGNAL(generationRate(double)), this, SLOT(showGenerationRate(double)));
 
     // combo boxes
-    connect(ui->universeModeControl, SIGNAL(currentIndexChanged(int)), game, SLOT(setUniverseMode(int)));
+    connect(ui->universeModeControl, SIGNAL(currentIndexChanged(int)), this, SLOT(selectUniverseMode(int)));
+    connect(ui->universeModeControl, SIGNAL(activated(int)), this, SLOT(chooseRule(int)));
     connect(ui->cellModeControl, SIGNAL(currentIndexChanged(int)), game, SLOT(setCellMode(int)));
+    connect(ui->boundaryControl, SIGNAL(currentIndexChanged(int)), game, SLOT(setBoundary(int)));
+    connect(ui->cyclicNeighbourhoodControl, SIGNAL(currentIndexChanged(int)), this, SLOT(selectCyclic()));
+    connect(ui->cyclicStatesControl, SIGNAL(valueChanged(int)), this, SLOT(selectCyclic()));
+    connect(ui->cyclicThresholdControl, SIGNAL(valueChanged(int)), this, SLOT(selectCyclic()));
 
     // when one of the cells has been changed => lock button "Universe Size"
     connect(game, SIGNAL(environmentChanged(bool)), ui->universeSizeControl, SLOT(setDisabled(bool)));
@@ -58,6 +91,28 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->saveButton, SIGNAL(clicked()), this, SLOT(saveGame()));
     connect(ui->loadButton, SIGNAL(clicked()), this, SLOT(loadGame()));
 
+    /* jump many generations at once */
+    connect(ui->jumpButton, SIGNAL(clicked()), this, SLOT(jumpGame()));
+
+    /* step back and scrub through the last generations */
+    connect(ui->stepBackButton, SIGNAL(clicked()), game, SLOT(stepBack()));
+    connect(ui->rewindSlider, SIGNAL(valueChanged(int)), game, SLOT(rewindTo(int)));
+    connect(ui->rewindMemoryControl, SIGNAL(valueChanged(int)), game, SLOT(setRewindMemory(int)));
+    connect(game, SIGNAL(rewindRange(qulonglong, qulonglong, qulonglong)),
+            this, SLOT(showRewindRange(qulonglong, qulonglong, qulonglong)));
+
+    /* instrumentation readout, per generation log and trace */
+    ui->statsLabel->setVisible(false);
+    connect(ui->instrumentControl, SIGNAL(toggled(bool)), game, SLOT(setInstrumentation(bool)));
+    connect(ui->instrumentControl, SIGNAL(toggled(bool)), ui->statsLabel, SLOT(setVisible(bool)));
+    connect(game, SIGNAL(statistics(QString)), this, SLOT(showStatistics(QString)));
+    connect(ui->statsLogButton, SIGNAL(toggled(bool)), this, SLOT(logStatistics(bool)));
+    connect(ui->traceButton, SIGNAL(toggled(bool)), this, SLOT(traceGame(bool)));
+
+    /* record the run, replay a recording */
+    connect(ui->recordButton, SIGNAL(toggled(bool)), this, SLOT(recordGame(bool)));
+    connect(ui->replayButton, SIGNAL(clicked()), this, SLOT(replayGame()));
+
     /* stretch layout for better looks */
     ui->mainLayout->setStretchFactor(ui->gameLayout, 8);
     ui->mainLayout->setStretchFactor(ui->settingsLayout, 3);
@@ -78,12 +133,28 @@ void MainWindow::saveGame() {
      *
      */
 
+    QString selected;
     QString filename = QFileDialog::getSaveFileName(this,
                                                     tr("Save current game"),
                                                     QDir::homePath(),
-                                                    tr("Snake Game *.snake Files (*.snake)"));
+                                                    tr("Cellular Automata (*.ca);;"
+                                                       "Life RLE pattern (*.rle);;"
+                                                       "Snake Game *.snake Files (*.snake)"),
+                                                    &selected);
     if (filename.length() < 1)
         return;
+    if (QFileInfo(filename).suffix().isEmpty())
+        filename += selected.contains("*.rle") ? ".rle" : selected.contains("*.snake") ? ".snake" : ".ca";
+
+    /* binary format and RLE patterns are written by the simulation itself */
+    if (!filename.endsWith(".snake", Qt::CaseInsensitive)) {
+        if (!game->saveGame(filename))
+            QMessageBox::warning(this,
+                                 tr("File Not Saved"),
+                                 tr("For whatever reason the game could not be written to the chosen file."),
+                                 QMessageBox::Ok);
+        return;
+    }
 
     QFile file(filename);
 
@@ -121,9 +192,64 @@ void MainWindow::loadGame() {
     QString filename = QFileDialog::getOpenFileName(this,
                                                     tr("Open saved game"),
                                                     QDir::homePath(),
-                                                    tr("Snake Game File (*.snake)"));
+                                                    tr("Saved games (*.ca *.rle *.snake);;"
+                                                       "Cellular Automata (*.ca);;"
+                                                       "Life RLE pattern (*.rle);;"
+                                                       "Snake Game File (*.snake)"));
     if (filename.length() < 1)
         return;
+
+    /* binary format and RLE patterns: apply the settings of the header, then the cells are streamed in */
+    if (!filename.endsWith(".snake", Qt::CaseInsensitive)) {
+        std::ifstream in(QFile::encodeName(filename).constData(), std::ios::binary);
+        bool ok;
+        if (filename.endsWith(".rle", Qt::CaseInsensitive)) {
+            int width, height;
+            std::string rule;
+            ok = CAfile::readRLEHeader(in, width, height, &rule);
+            if (ok) {
+                ui->universeSizeControl->setValue(qMax(ui->universeSizeControl->value(), qMax(width, height) + 2));
+                game->setUniverseSize(ui->universeSizeControl->value());
+                /* the pattern is meant for its rule, e.g. a HighLife replicator; B3/S23 keeps the current game */
+                unsigned birth, survive;
+                bool life = ui->universeModeControl->currentIndex() < 3;
+                if (CArule::parse(rule, birth, survive) && !(life && CArule::format(birth, survive) == "B3/S23"))
+                    showRule(0, birth, survive);
+            }
+        }
+        else {
+            CAfile::Header header;
+            int encoding;
+            ok = CAfile::readHeader(in, header, encoding);
+            /* the field is square and its size must be one of the size control, or nothing is changed */
+            ok = ok && header.nx == header.ny && header.nx >= ui->universeSizeControl->minimum()
+                    && header.nx <= ui->universeSizeControl->maximum();
+            if (ok) {
+                ui->universeSizeControl->setValue(header.nx);
+                game->setUniverseSize(header.nx);
+                showRule(header.universeMode, header.birth, header.survive);
+                if (header.cellMode < ui->cellModeControl->count())
+                    ui->cellModeControl->setCurrentIndex(header.cellMode);
+
+                currentColor = QColor((QRgb) header.color);
+                game->setMasterColor(currentColor);
+                QPixmap icon(16, 16);
+                icon.fill(currentColor);
+                ui->colorRandomButton->setIcon(QIcon(icon));
+                ui->colorSelectButton->setIcon(QIcon(icon));
+
+                ui->intervalControl->setValue(header.interval);
+                game->setInterval(header.interval);
+            }
+        }
+        if (!ok || !game->loadGame(filename))
+            QMessageBox::warning(this,
+                                 tr("File Not Loaded"),
+                                 tr("For whatever reason the chosen file could not be loaded."),
+                                 QMessageBox::Ok);
+        return;
+    }
+
     QFile file(filename);
 
     if (!file.open(QIODevice::ReadOnly)){
@@ -135,8 +261,15 @@ void MainWindow::loadGame() {
     }
     QTextStream file_input_stream(&file);
 
-    int stream_value;
+    int stream_value = 0;
     file_input_stream >> stream_value;
+    if (stream_value < ui->universeSizeControl->minimum() || stream_value > ui->universeSizeControl->maximum()) {
+        QMessageBox::warning(this,
+                             tr("File Not Loaded"),
+                             tr("For whatever reason the chosen file could not be loaded."),
+                             QMessageBox::Ok);
+        return;
+    }
     ui->universeSizeControl->setValue(stream_value);
 
     game->setUniverseSize(stream_value);
@@ -168,6 +301,107 @@ void MainWindow::loadGame() {
 }
 
 
+void MainWindow::jumpGame() {
+    /* ask for the number of generations and let the game jump over them */
+    bool ok;
+    int number = QInputDialog::getInt(this,
+                                      tr("Jump Generations"),
+                                      tr("Number of generations:"),
+                                      1000, 1, 1000000000, 1, &ok);
+    if (!ok)
+        return;
+    game->jumpGame(number);
+}
+
+
+void MainWindow::recordGame(bool on) {
+    /* start or stop recording every generation into a trajectory file */
+    if (!on) {
+        game->stopRecording();
+        return;
+    }
+    QString filename = QFileDialog::getSaveFileName(this,
+                                                    tr("Record game"),
+                                                    QDir::homePath(),
+                                                    tr("Recording (*.catr)"));
+    if (QFileInfo(filename).suffix().isEmpty() && filename.length() > 0)
+        filename += ".catr";
+    if (filename.length() < 1 || !game->startRecording(filename)) {
+        ui->recordButton->setChecked(false);
+        return;
+    }
+}
+
+
+void MainWindow::logStatistics(bool on) {
+    /* start or stop writing one CSV line per generation: time of the evolution, population, births, deaths */
+    if (!on) {
+        game->stopStatsLog();
+        return;
+    }
+    QString filename = QFileDialog::getSaveFileName(this,
+                                                    tr("Log statistics"),
+                                                    QDir::homePath(),
+                                                    tr("CSV (*.csv)"));
+    if (QFileInfo(filename).suffix().isEmpty() && filename.length() > 0)
+        filename += ".csv";
+    if (filename.length() < 1 || !game->startStatsLog(filename))
+        ui->statsLogButton->setChecked(false);
+}
+
+
+void MainWindow::traceGame(bool on) {
+    /* start or stop the Chrome trace of evolution, rendering and painting */
+    if (!on) {
+        game->stopTrace();
+        return;
+    }
+    QString filename = QFileDialog::getSaveFileName(this,
+                                                    tr("Trace"),
+                                                    QDir::homePath(),
+                                                    tr("Chrome trace (*.json)"));
+    if (QFileInfo(filename).suffix().isEmpty() && filename.length() > 0)
+        filename += ".json";
+    if (filename.length() < 1 || !game->startTrace(filename))
+        ui->traceButton->setChecked(false);
+}
+
+
+void MainWindow::replayGame() {
+    /* open a recording and show the asked generations until the dialog is cancelled */
+    QString filename = QFileDialog::getOpenFileName(this,
+                                                    tr("Replay recording"),
+                                                    QDir::homePath(),
+                                                    tr("Recording (*.catr)"));
+    if (filename.length() < 1)
+        return;
+    qlonglong last = game->openRecording(filename);
+    if (last < 0) {
+        QMessageBox::warning(this,
+                             tr("File Not Loaded"),
+                             tr("For whatever reason the chosen file could not be loaded."),
+                             QMessageBox::Ok);
+        return;
+    }
+
+    int maximum = (int) qMin<qlonglong>(last, INT_MAX);
+    int generation = 0;
+    bool ok = true;
+    while (ok) {
+        game->seekRecording(generation);
+        /* the size control must not reset the universe that was just loaded */
+        ui->universeSizeControl->blockSignals(true);
+        ui->universeSizeControl->setValue(game->getUniverseSize());
+        ui->universeSizeControl->blockSignals(false);
+
+        generation = QInputDialog::getInt(this,
+                                          tr("Replay recording"),
+                                          tr("Generation (0 .. %1):").arg(last),
+                                          qMin(generation + 1, maximum), 0, maximum, 1, &ok);
+    }
+}
+
+
 void MainWindow::selectMasterColor() {
     /* set cell color to color chosen from color dialog */
     QColor color = QColorDialog::getColor(currentColor, this, tr("Select Cell Color"));
@@ -205,6 +439,93 @@ void MainWindow::selectRandomColor() {
 }
 
 
+void MainWindow::showGenerationRate(double gensPerSecond) {
+    /* live readout of the generations per second */
+    ui->rateLabel->setText(QString::number(gensPerSecond, 'f', 0) + tr(" gens/s"));
+}
+
+
+void MainWindow::showStatistics(const QString &text) {
+    ui->statsLabel->setText(text);
+}
+
+
+void MainWindow::showRewindRange(qulonglong oldest, qulonglong newest, qulonglong current) {
+    /* follow the game with the scrub slider, unless it is being dragged */
+    if (ui->rewindSlider->isSliderDown())
+        return;
+    ui->rewindSlider->blockSignals(true);
+    ui->rewindSlider->setRange((int) qMin<qulonglong>(oldest, INT_MAX), (int) qMin<qulonglong>(newest, INT_MAX));
+    ui->rewindSlider->setValue((int) qMin<qulonglong>(current, INT_MAX));
+    ui->rewindSlider->blockSignals(false);
+    ui->stepBackButton->setEnabled(current > oldest);
+}
+
+
+void MainWindow::selectUniverseMode(int index) {
+    /* the Life-like rules are "Classic Life" with another rule */
+    QString rule = ui->universeModeControl->itemData(index).toString();
+    if (!rule.isEmpty())
+        game->setRule(rule);
+    game->setUniverseMode(index <= 3 ? index : 0);
+}
+
+
+void MainWindow::selectCyclic() {
+    /* a von Neumann cell has only four neighbours */
+    bool moore = ui->cyclicNeighbourhoodControl->currentIndex() == 0;
+    ui->cyclicThresholdControl->setMaximum(moore ? 8 : 4);
+    game->setCyclic(ui->cyclicStatesControl->value(), ui->cyclicThresholdControl->value(), moore);
+}
+
+
+void MainWindow::chooseRule(int index) {
+    /* the custom rule is asked for every time it is chosen */
+    if (index != ui->universeModeControl->count() - 1)
+        return;
+    bool ok;
+    QString rule = QInputDialog::getText(this,
+                                         tr("Custom Rule"),
+                                         tr("Rule (e.g. B36/S23 or 23/36):"),
+                                         QLineEdit::Normal,
+                                         ui->universeModeControl->itemData(index).toString(),
+                                         &ok);
+    if (!ok)
+        return;
+    unsigned birth, survive;
+    if (!CArule::parse(rule.toStdString(), birth, survive)) {
+        QMessageBox::warning(this,
+                             tr("Invalid Rule"),
+                             tr("Rules are written as B (neighbours for birth) / S (neighbours for survival), e.g. B3/S23."),
+                             QMessageBox::Ok);
+        return;
+    }
+    showRule(0, birth, survive);
+}
+
+
+void MainWindow::showRule(int universeMode, unsigned birth, unsigned survive) {
+    /* select the game and the rule, a rule that is no preset becomes the custom one */
+    QComboBox *control = ui->universeModeControl;
+    QString rule = QString::fromStdString(CArule::format(birth, survive));
+    int index = universeMode;
+    if (universeMode == 0) {
+        index = control->findData(rule);
+        if (index < 0) {
+            index = control->count() - 1;
+            control->setItemData(index, rule);
+            control->setItemText(index, tr("Custom Rule (%1)...").arg(rule));
+        }
+    }
+    if (index < 0 || index >= control->count())
+        return;
+    if (index == control->currentIndex())
+        selectUniverseMode(index);
+    else
+        control->setCurrentIndex(index);
+}
+
+
 void MainWindow::goGame() {
     /*
      *  mit entsprechendem Inhalt zu fuellen
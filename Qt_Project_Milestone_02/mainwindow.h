@@ -22,9 +22,22 @@ public slots:
     void selectRandomColor();
     void saveGame();
     void loadGame();
+    void jumpGame();
+    void recordGame(bool on);
+    void logStatistics(bool on);
+    void traceGame(bool on);
+    void replayGame();
     void goGame();
+    void selectUniverseMode(int index);
+    void chooseRule(int index);
+    void selectCyclic();
+    void showGenerationRate(double gensPerSecond);
+    void showStatistics(const QString &text);
+    void showRewindRange(qulonglong oldest, qulonglong newest, qulonglong current);
 
 private:
+    void showRule(int universeMode, unsigned birth, unsigned survive);
+
     Ui::MainWindow *ui;
     QColor currentColor;
     GameWidget *game;
@@ -0,0 +1,113 @@
+/*
+ *  Headless Snake self-play: plays many games of a bot at once on all cores and reports
+ *  the results and the steps per second.
+ *
+ *  Needs no Qt, build it for example with
+ *      g++ -O2 -std=c++11 -pthread selfplay.cpp -o ca_selfplay
+ *
+ *  Usage: ca_selfplay [options]
+ *      -p <policy>   random, greedy or cycle (default: greedy), see CAselfplay.h
+ *      -n <games>    number of games (default: 1000)
+ *      -s <size>     cells in one row, 10 .. 400 as in the game (default: 50)
+ *      -t <threads>  number of threads (default: all cores)
+ *      -m <steps>    steps after which a game is stopped (default: size^4, enough for the
+ *                    cycle to fill the universe)
+ *      --seed <n>    seed of the run, every game gets its own seed from it (default: 1)
+ *      -o <file>     write one CSV line per game: game, seed, steps, length, result
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "CAselfplay.h"
+
+
+static const char *resultName(CAsnake::Result r) {
+    switch (r) {
+    case CAsnake::DIED: return "died";
+    case CAsnake::WON: return "won";
+    default: return "stopped";
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    std::string policyName = "greedy", output;
+    int games = 1000, size = 50;
+    int threads = (int) std::max(1u, std::thread::hardware_concurrency());
+    int64_t maxSteps = -1;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-p") && i + 1 < argc) policyName = argv[++i];
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc) games = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc) size = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-m") && i + 1 < argc) maxSteps = atoll(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = strtoull(argv[++i], 0, 10);
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) output = argv[++i];
+        else {
+            std::cerr << "usage: " << argv[0] << " [-p random|greedy|cycle] [-n games] [-s size]"
+                      << " [-t threads] [-m steps] [--seed n] [-o file.csv]\n";
+            return 2;
+        }
+    }
+    if (games < 1 || size < 10 || size > 400 || threads < 1) {
+        std::cerr << "games, size (10 .. 400) and threads must be positive\n";
+        return 2;
+    }
+    if (maxSteps < 0)
+        maxSteps = (int64_t) size * size * size * size;
+
+    CAselfplay::PolicyFactory policy;
+    if (policyName == "random") policy = [] { return std::unique_ptr<CAsnakePolicy>(new CAsnakeRandom); };
+    else if (policyName == "greedy") policy = [] { return std::unique_ptr<CAsnakePolicy>(new CAsnakeGreedy); };
+    else if (policyName == "cycle" && size % 2 == 0) policy = [] { return std::unique_ptr<CAsnakePolicy>(new CAsnakeCycle); };
+    else {
+        std::cerr << "unknown policy " << policyName << " (cycle needs an even size)\n";
+        return 2;
+    }
+
+    CAselfplay selfplay(threads);
+    const std::vector<CAselfplay::Game> &results = selfplay.run(games, size, seed, policy, maxSteps);
+
+    if (!output.empty()) {
+        std::ofstream out(output.c_str());
+        out << "game,seed,steps,length,result\n";
+        for (size_t g = 0; g < results.size(); g++)
+            out << g << "," << results[g].seed << "," << results[g].steps << ","
+                << results[g].length << "," << resultName(results[g].result) << "\n";
+        if (!out) {
+            std::cerr << "could not write " << output << "\n";
+            return 1;
+        }
+    }
+
+    /* summary, one "key value" pair per line as ca_batch */
+    long long won = 0, died = 0, lengths = 0;
+    int best = 0;
+    for (size_t g = 0; g < results.size(); g++) {
+        won += results[g].result == CAsnake::WON;
+        died += results[g].result == CAsnake::DIED;
+        lengths += results[g].length;
+        best = std::max(best, results[g].length);
+    }
+    double seconds = selfplay.getSeconds();
+    std::cout << "policy " << policyName << "\n"
+              << "games " << games << "\n"
+              << "size " << size << "\n"
+              << "threads " << threads << "\n"
+              << "won " << won << "\n"
+              << "died " << died << "\n"
+              << "stopped " << games - won - died << "\n"
+              << "mean_length " << (double) lengths / games << "\n"
+              << "best_length " << best << "\n"
+              << "steps " << selfplay.getSteps() << "\n"
+              << "seconds " << seconds << "\n"
+              << "steps_per_second " << (seconds > 0 ? selfplay.getSteps() / seconds : 0) << "\n";
+    return 0;
+}
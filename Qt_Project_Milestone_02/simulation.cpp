@@ -0,0 +1,776 @@
+#include <QFile>
+#include <QTimer>
+#include <string.h>
+#include <fstream>
+#include "simulation.h"
+#include "CAfile.h"
+#include "CAhashlife.h"
+#include "CArandom.h"
+#include "CArule.h"
+
+
+Simulation::Simulation(QObject *parent) :
+    QObject(parent),
+    timer(new QTimer(this)),
+    generations(-1),
+    ca1(),
+    universeSize(50),
+    universeMode(0),
+    cellMode(0),
+    masterColor(Qt::black),
+    interval(300),
+    randomSeed(1),
+    turbo(false),
+    turboRate(0),
+    turboDone(0),
+    rateCount(0),
+    instrumented(false),
+    statsLogLines(0),
+    tracing(false),
+    imageStale(true)
+{
+    timer->setInterval(300);
+    updatePalette();
+    ca1.setBitPacked(true); // "Classic Life" with "Classic" cells is the default
+    ca1.resetWorldSize(universeSize, universeSize);
+    connect(timer, SIGNAL(timeout()), this, SLOT(newGeneration()));
+    publish();
+}
+
+
+const Simulation::Frame &Simulation::latestFrame() {
+    /* latest complete frame; called from the GUI thread, never waits for the simulation */
+    frames.update();
+    return frames.getFront();
+}
+
+
+void Simulation::startGame(int number) {
+    /* start the game */
+    generations = number;
+    /* a snake that is dead starts again */
+    if (universeMode == 1 && !snake.isAlive())
+        newSnake();
+    frameClock.start();
+    turboClock.start();
+    turboDone = 0;
+    rateClock.start();
+    rateCount = 0;
+    timer->start();
+}
+
+
+void Simulation::stopGame() {
+    /* stop the game */
+    timer->stop();
+    emit generationRate(0);
+}
+
+
+void Simulation::clearGame() {
+    stopGame();
+    ca1.resetWorldSize(universeSize, universeSize);
+    sparse.clear();
+    if (universeMode == 1)
+        newSnake();
+    /* an empty cyclic CA would never change, it starts from a new random field instead */
+    if (universeMode == 3)
+        seedCyclic();
+    /* the rewind buffer holds the generations of one game, a cleared, resized or loaded field starts it anew */
+    rewind.clear();
+    publish();
+}
+
+
+void Simulation::jumpGame(int number) {
+    /* jump number generations ahead with HashLife, only for "Classic Life" (B3/S23) with classic cells.
+     * HashLife has no border, so the result differs from the bounded universe once the pattern reaches its edges */
+    if (number <= 0 || universeMode != 0 || cellMode != 0 || !ca1.isClassicLife())
+        return;
+    stopGame();
+
+    CAhashlife hashLife;
+    hashLife.importWorld(ca1);
+    hashLife.run(number);
+    hashLife.exportWorld(ca1);
+    /* the generations jumped over are neither in the recording (a keyframe follows them) nor in the rewind buffer */
+    recorder.skip((uint64_t) number, ca1);
+    rewind.clear();
+    publish();
+}
+
+
+void Simulation::setUniverseSize(int s) {
+    /* set number of the cells in one row */
+    universeSize = s;
+    ca1.resetWorldSize(s, s);
+    if (universeMode == 1)
+        newSnake();
+    if (universeMode == 3)
+        seedCyclic();
+    rewind.clear();
+    publish();
+}
+
+
+void Simulation::setUniverseMode(int m) {
+    /* set universe mode */
+    universeMode = m;
+    imageStale = true;
+    /* classic life with classic cells only needs 0/1 cells, so the bit-packed universe can be used */
+    ca1.setBitPacked((universeMode == 0 || universeMode == 2) && cellMode == 0);
+    /* "Unbounded Life" starts from the cells on the field, which is then a window into it */
+    if (universeMode == 2) {
+        sparse.clear();
+        sparse.importWorld(ca1);
+    }
+    /* "Snake" plays on the int universe, the field is cleared for it */
+    if (universeMode == 1)
+        newSnake();
+    /* "Cyclic CA" evolves the color universe, starting from random states */
+    if (universeMode == 3)
+        seedCyclic();
+    rewind.clear();
+    publish();
+}
+
+
+void Simulation::setCyclic(int states, int threshold, bool moore) {
+    /* the colors follow the number of states */
+    ca1.setCyclic(states, threshold, moore);
+    updatePalette();
+    publish();
+}
+
+
+void Simulation::setSeed(qulonglong seed) {
+    /* the random fields of "Cyclic CA" and the snakes that follow are the same for the same seed */
+    randomSeed = seed;
+}
+
+
+void Simulation::setBoundary(int b) {
+    /* "Unbounded Life" has no edges, "Snake" has walls */
+    ca1.setBoundary((CAbase::Boundary) b);
+}
+
+
+void Simulation::seedCyclic() {
+    /* spirals grow out of the random field */
+    for (int k = 1; k <= universeSize; k++)
+        for (int j = 1; j <= universeSize; j++)
+            ca1.setColor(j, k, (int) (splitmix64(randomSeed) % (uint64_t) ca1.getCyclicStates()));
+}
+
+
+void Simulation::newSnake() {
+    /* the snake starts at the bottom in the middle, heading up */
+    snake.reset(ca1, splitmix64(randomSeed));
+}
+
+
+void Simulation::turnSnake(int direction) {
+    /* a turn back into the body is ignored, quick turns between two steps are kept */
+    if (direction >= CAsnake::UP && direction <= CAsnake::LEFT)
+        snake.turn((CAsnake::Direction) direction);
+}
+
+
+bool Simulation::setRule(const QString &rule) {
+    /* the evolution uses kernels compiled for the well known rules, any other rule runs on the generic ones */
+    unsigned birth, survive;
+    if (!CArule::parse(rule.toStdString(), birth, survive))
+        return false;
+    ca1.setRule(birth, survive);
+    return true;
+}
+
+
+void Simulation::setCellMode(int m) {
+    /* set cell mode */
+    cellMode = m;
+    ca1.setBitPacked((universeMode == 0 || universeMode == 2) && cellMode == 0);
+}
+
+
+void Simulation::setInterval(int msec) {
+    /* set interval between generations, ignored in turbo mode */
+    interval = msec;
+    if (!turbo)
+        timer->setInterval(msec);
+}
+
+
+void Simulation::setTurbo(bool on) {
+    /* turbo: generations are no longer tied to frames, the timer fires as often as possible */
+    turbo = on;
+    timer->setInterval(turbo ? (turboRate > 0 ? 1 : 0) : interval);
+    turboClock.start();
+    turboDone = 0;
+}
+
+
+void Simulation::setTurboRate(int gensPerSecond) {
+    /* target generations per second in turbo mode, 0 = as fast as possible */
+    turboRate = gensPerSecond;
+    setTurbo(turbo);
+}
+
+
+void Simulation::setThreads(int n) {
+    /* set number of threads for the evolution */
+    ca1.setThreads(n);
+}
+
+
+void Simulation::setMasterColor(const QColor &color) {
+    masterColor = color;
+    updatePalette();
+    publish();
+}
+
+
+void Simulation::editCell(int x, int y, bool toggle) {
+    /* mouse edit: toggle cell x, y (press) or only bring it to life (move) */
+    QVector<int> cells;
+    cells << x << y;
+    editCells(cells, toggle);
+}
+
+
+void Simulation::editCells(const QVector<int> &cells, bool toggle) {
+    /* all edits of a stroke (x, y pairs) go into one frame, which repaints only the edited cells */
+    render(true); // what changed before, e.g. generations not published in turbo mode
+    QRegion edited;
+    for (int i = 0; i + 1 < cells.size(); i += 2)
+        if (applyEdit(cells[i], cells[i + 1], toggle))
+            edited += QRect(cells[i] - 1, cells[i + 1] - 1, 1, 1);
+    if (edited.isEmpty())
+        return;
+    render(false);
+    damage += edited;
+    publish();
+}
+
+
+bool Simulation::applyEdit(int x, int y, bool toggle) {
+    /* one cell of an edit, the frame is published by the caller */
+    if (x < 1 || x > universeSize || y < 1 || y > universeSize)
+        return false;
+
+    /* the snake field is played with the keys only */
+    if (universeMode == 1)
+        return false;
+
+    /* cyclic CA: every click advances the cell by one state */
+    if (universeMode == 3) {
+        if (!toggle)
+            return false;
+        ca1.setColor(x, y, (ca1.getColor(x, y) + 1) % ca1.getCyclicStates());
+        return true;
+    }
+
+    int mode[9] = {1, 3, 6, 4, 2, 8, 9, 10, 11};
+
+    if (ca1.isAlive(x, y) != 0) {
+        if (!toggle)
+            return false;
+        ca1.setAlive(x, y, 0);
+        ca1.setLife(x, y, 0);
+    }
+    else {
+        ca1.setAlive(x, y, mode[cellMode]);
+        if (mode[cellMode] == 9 || mode[cellMode] == 10)
+            ca1.setLife(x, y, 50); // lifeTime = 50
+    }
+    if (universeMode == 2)
+        sparse.setCell(x - 1, y - 1, ca1.isAlive(x, y) == 1);
+    return true;
+}
+
+
+QString Simulation::dumpGame() {
+    /* dump current universe */
+    char temp;
+    QString master = "";
+    for (int k = 1; k <= universeSize; k++) {
+        for (int j = 1; j <= universeSize; j++) {
+            if (ca1.isAlive(j, k) == 1) {
+                temp = '*';
+            } else {
+                temp = 'o';
+            }
+            master.append(temp);
+        }
+        master.append("\n");
+    }
+    return master;
+}
+
+
+void Simulation::reconstructGame(const QString &data) {
+     // reconstruct game from dump
+    int current = 0;
+    for (int k = 1; k <= universeSize; k++) {
+        for (int j = 1; j <= universeSize; j++) {
+           if (data[current] == '*') ca1.setAlive(j, k, 1);
+            current++;
+        }
+        current++;
+    }
+    if (universeMode == 2) {
+        sparse.clear();
+        sparse.importWorld(ca1);
+    }
+    rewind.clear();
+    publish();
+}
+
+
+bool Simulation::saveGame(const QString &filename) {
+    /* save in the binary format with the settings in its header, or as Life RLE pattern */
+    std::ofstream out(QFile::encodeName(filename).constData(), std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    if (filename.endsWith(".rle", Qt::CaseInsensitive))
+        return CAfile::saveRLE(out, ca1);
+
+    CAfile::Header header;
+    header.universeMode = universeMode;
+    header.cellMode = cellMode;
+    header.color = masterColor.rgb() & 0xFFFFFF;
+    header.interval = interval;
+    header.birth = ca1.getBirth();
+    header.survive = ca1.getSurvive();
+    return CAfile::save(out, ca1, header);
+}
+
+
+bool Simulation::loadGame(const QString &filename) {
+    /* load a binary save or a Life RLE pattern straight into the universe */
+    std::ifstream in(QFile::encodeName(filename).constData(), std::ios::binary);
+    if (!in)
+        return false;
+    bool ok;
+    if (filename.endsWith(".rle", Qt::CaseInsensitive)) {
+        ok = CAfile::loadRLE(in, ca1);
+    }
+    else {
+        /* a square universe of a size the controls can show, checked before anything is resized */
+        CAfile::Header header;
+        int encoding;
+        if (!CAfile::readHeader(in, header, encoding) || header.nx != header.ny
+                || header.nx < MIN_SIZE || header.nx > MAX_SIZE)
+            return false;
+        in.seekg(0);
+        ok = CAfile::load(in, ca1, header);
+    }
+    universeSize = ca1.getNx();
+    if (universeMode == 2) {
+        sparse.clear();
+        sparse.importWorld(ca1);
+    }
+    rewind.clear();
+    publish();
+    return ok;
+}
+
+
+bool Simulation::startRecording(const QString &filename) {
+    /* keyframe of the current universe, then every generation as delta */
+    return recorder.open(QFile::encodeName(filename).constData(), ca1);
+}
+
+
+void Simulation::stopRecording() {
+    recorder.close();
+}
+
+
+qlonglong Simulation::openRecording(const QString &filename) {
+    if (!player.open(QFile::encodeName(filename).constData()))
+        return -1;
+    return (qlonglong) player.getLastGeneration();
+}
+
+
+int Simulation::seekRecording(qlonglong generation) {
+    /* nearest keyframe and the deltas up to generation */
+    stopGame();
+    if (generation < 0 || !player.seek((uint64_t) generation, ca1))
+        return 0;
+    universeSize = ca1.getNx();
+    if (universeMode == 2) {
+        sparse.clear();
+        sparse.importWorld(ca1);
+    }
+    rewind.clear();
+    publish();
+    return universeSize;
+}
+
+
+void Simulation::stepBack() {
+    if (rewind.getCurrent() > rewind.getOldest())
+        rewindTo((qlonglong) rewind.getCurrent() - 1);
+}
+
+
+void Simulation::rewindTo(qlonglong generation) {
+    /* go back (or forth again) to a generation in the rewind buffer */
+    stopGame();
+    if (generation < 0 || !rewind.seek((uint64_t) generation, ca1))
+        return;
+    /* the universe is going to repeat generations it already had, that is no cycle */
+    ca1.forgetHistory();
+    if (universeMode == 2) {
+        sparse.clear();
+        sparse.importWorld(ca1);
+    }
+    publish();
+}
+
+
+void Simulation::setRewindMemory(int megabytes) {
+    rewind.setBudget((size_t) megabytes << 20);
+    emit rewindRange(rewind.getOldest(), rewind.getNewest(), rewind.getCurrent());
+}
+
+
+void Simulation::setInstrumentation(bool on) {
+    /* the timers only run while someone looks at them */
+    instrumented = on;
+    stats.clear();
+}
+
+
+bool Simulation::startStatsLog(const QString &filename) {
+    stopStatsLog();
+    statsLog.open(QFile::encodeName(filename).constData(), std::ios::trunc);
+    if (!statsLog)
+        return false;
+    statsLog << "generation,evolve_ns,population,births,deaths\n";
+    statsLogLines = 0;
+    return true;
+}
+
+
+void Simulation::stopStatsLog() {
+    if (statsLog.is_open())
+        statsLog.close();
+}
+
+
+bool Simulation::startTrace(const QString &filename) {
+    tracing = trace.open(QFile::encodeName(filename).constData());
+    return tracing;
+}
+
+
+void Simulation::stopTrace() {
+    tracing = false;
+    trace.close();
+}
+
+
+void Simulation::instrument(int64_t start) {
+    /* duration of the evolution; population, births and deaths are counted by CAbase anyway */
+    int64_t ns = CAstats::now() - start;
+    stats.add(CAstats::EVOLVE, ns);
+    if (tracing)
+        trace.event("evolve", CAtrace::SIMULATION, start, ns);
+    if (statsLog.is_open())
+        statsLog << ++statsLogLines << "," << ns << "," << ca1.getPopulation() << ","
+                 << ca1.getBirths() << "," << ca1.getDeaths() << "\n";
+}
+
+
+void Simulation::newGeneration() {
+    /* start the evolution of universe and publish the new frame */
+    if (!turbo) {
+        if (evolve())
+            publish();
+        measureRate();
+        return;
+    }
+
+    /* turbo: evolve until the frame is due (or the target rate is reached), then publish once */
+    qint64 lag = (qint64) turboRate * FRAME_MSEC / 1000; // never catch up more than one frame
+    while (frameClock.elapsed() < FRAME_MSEC) {
+        if (turboRate > 0) {
+            qint64 due = (qint64) ((double) turboRate * turboClock.nsecsElapsed() / 1e9);
+            if (turboDone < due - lag)
+                turboDone = due - lag;
+            if (turboDone >= due)
+                break;
+        }
+        turboDone++;
+        if (!evolve())
+            return;
+    }
+    if (frameClock.elapsed() >= FRAME_MSEC) {
+        publish();
+        frameClock.restart();
+    }
+    measureRate();
+}
+
+
+bool Simulation::evolve() {
+    /* one generation; when the game ends, publish the last frame, stop and return false */
+    if (generations < 0)
+        generations++;
+    const int64_t start = isMeasuring() ? CAstats::now() : 0;
+
+    if (universeMode == 1) {
+        /* "Snake": one step, the same few cells change whatever the length of the snake */
+        CAsnake::Result result = snake.step(ca1);
+        if (start)
+            instrument(start);
+        rateCount++;
+        if (result == CAsnake::DIED || result == CAsnake::WON) {
+            publish();
+            stopGame();
+            emit snakeEnded(result == CAsnake::WON, snake.getLength());
+            return false;
+        }
+        return true;
+    }
+    if (universeMode == 3) {
+        /* "Cyclic CA" on the color universe, the living cells and so the recordings stay as they are */
+        ca1.worldEvolutionCyclic();
+    }
+    else {
+        rewind.begin(ca1);
+        if (universeMode == 2) {
+            /* "Unbounded Life": evolve the sparse universe and show the window at 0, 0 */
+            sparse.step();
+            sparse.exportWorld(ca1);
+        }
+        else {
+            ca1.worldEvolutionLife();
+        }
+        recorder.record(ca1);
+        rewind.capture(ca1);
+    }
+    if (start)
+        instrument(start);
+    rateCount++;
+
+    if (universeMode == 2 ? sparse.isNotChanged() : ca1.isNotChanged()) {
+        publish();
+        stopGame();
+        emit universeConstant();
+        return false;
+    }
+
+    if (universeMode != 2 && ca1.getPeriod() > 1) {
+        /* the universe is in a cycle (oscillators, gliders on the torus), it will never end by itself */
+        publish();
+        stopGame();
+        emit universeCycle(ca1.getCycleStart(), ca1.getPeriod());
+        return false;
+    }
+
+    generations--;
+    if (generations == 0) {
+        publish();
+        stopGame();
+        emit iterationsFinished();
+        return false;
+    }
+    return true;
+}
+
+
+void Simulation::measureRate() {
+    /* generations per second, reported about twice a second */
+    qint64 ms = rateClock.elapsed();
+    if (ms < 500)
+        return;
+    double rate = rateCount * 1000.0 / ms;
+    emit generationRate(rate);
+    if (instrumented) {
+        QString text = tr("population %1 (+%2 -%3)\n").arg(ca1.getPopulation()).arg(ca1.getBirths()).arg(ca1.getDeaths())
+                     + tr("%1 cells/s\n").arg(rate * universeSize * universeSize, 0, 'g', 3)
+                     + phaseText(stats, CAstats::EVOLVE) + "\n"
+                     + phaseText(stats, CAstats::RENDER);
+        emit statistics(text);
+    }
+    rateClock.restart();
+    rateCount = 0;
+}
+
+
+void Simulation::render(bool tileDamage) {
+    /* write the changed tiles into universeImage; with tileDamage the whole tiles count as changed */
+    if (universeImage.empty() || universeImage[0].width() != universeSize) {
+        universeImage.clear();
+        for (int w = universeSize; ; w = (w + 1) / 2) {
+            universeImage.push_back(QImage(w, w, QImage::Format_ARGB32_Premultiplied));
+            if (w <= LOD_MIN)
+                break;
+        }
+        imageStale = true;
+    }
+
+    std::vector<int> tiles;
+    ca1.takeDirtyTiles(tiles);
+    if (imageStale) {
+        for (int k = 1; k <= universeSize; k++)
+            renderRow(k, 1, universeSize, (QRgb *) universeImage[0].scanLine(k - 1));
+        for (size_t l = 1; l < universeImage.size(); l++)
+            reduceLevel(l, 0, 0, universeImage[l].width() - 1, universeImage[l].height() - 1);
+        for (int b = 0; b < 3; b++)
+            stale[b].assign(ca1.getTileCount(), 1);
+        damage = QRect(0, 0, universeSize, universeSize);
+        imageStale = false;
+        return;
+    }
+    for (size_t i = 0; i < tiles.size(); i++) {
+        int x0, y0, x1, y1;
+        ca1.getTileRect(tiles[i], x0, y0, x1, y1);
+        for (int k = y0; k <= y1; k++)
+            renderRow(k, x0, x1, (QRgb *) universeImage[0].scanLine(k - 1));
+        for (size_t l = 1; l < universeImage.size(); l++)
+            reduceLevel(l, (x0 - 1) >> l, (y0 - 1) >> l, (x1 - 1) >> l, (y1 - 1) >> l);
+        for (int b = 0; b < 3; b++)
+            stale[b][tiles[i]] = 1;
+        if (tileDamage)
+            damage += QRect(x0 - 1, y0 - 1, x1 - x0 + 1, y1 - y0 + 1);
+    }
+}
+
+
+void Simulation::reduceLevel(int k, int x0, int y0, int x1, int y1) {
+    /* the mean of the 2 x 2 pixels below, two channels at a time; the pixels are premultiplied,
+       so living cells among dead ones give their color at the density of the living */
+    const QImage &below = universeImage[k - 1];
+    QImage &level = universeImage[k];
+    const QRgb zero = 0;
+    for (int y = y0; y <= y1; y++) {
+        const QRgb *top = (const QRgb *) below.constScanLine(2 * y);
+        const QRgb *bottom = 2 * y + 1 < below.height() ? (const QRgb *) below.constScanLine(2 * y + 1) : 0;
+        QRgb *line = (QRgb *) level.scanLine(y);
+        for (int x = x0; x <= x1; x++) {
+            const bool right = 2 * x + 1 < below.width();
+            QRgb p[4] = {top[2 * x], right ? top[2 * x + 1] : zero,
+                         bottom ? bottom[2 * x] : zero, bottom && right ? bottom[2 * x + 1] : zero};
+            uint32_t rb = 0, ag = 0;
+            for (int i = 0; i < 4; i++) {
+                rb += p[i] & 0x00FF00FF;
+                ag += (p[i] >> 8) & 0x00FF00FF;
+            }
+            line[x] = ((rb >> 2) & 0x00FF00FF) | (((ag >> 2) & 0x00FF00FF) << 8);
+        }
+    }
+}
+
+
+void Simulation::publish() {
+    /* bring the back buffer up to date with universeImage and hand it to the GUI with the damage */
+    const int64_t start = isMeasuring() ? CAstats::now() : 0;
+    render(true);
+
+    int b = frames.getBackIndex();
+    Frame &back = frames.getBack();
+    if (back.size() != universeImage.size() || back[0].size() != universeImage[0].size()) {
+        back.resize(universeImage.size());
+        for (size_t l = 0; l < universeImage.size(); l++)
+            back[l] = universeImage[l].copy();
+        stale[b].assign(ca1.getTileCount(), 0);
+    }
+    else {
+        for (int t = 0; t < ca1.getTileCount(); t++) {
+            if (!stale[b][t])
+                continue;
+            int x0, y0, x1, y1;
+            ca1.getTileRect(t, x0, y0, x1, y1);
+            for (size_t l = 0; l < universeImage.size(); l++) {
+                /* the pixels of the tile on every level */
+                int lx0 = (x0 - 1) >> l, lx1 = (x1 - 1) >> l;
+                for (int k = (y0 - 1) >> l; k <= (y1 - 1) >> l; k++)
+                    memcpy(back[l].scanLine(k) + lx0 * sizeof(QRgb),
+                           universeImage[l].constScanLine(k) + lx0 * sizeof(QRgb),
+                           (lx1 - lx0 + 1) * sizeof(QRgb));
+            }
+            stale[b][t] = 0;
+        }
+    }
+
+    frames.publish();
+    if (start) {
+        int64_t ns = CAstats::now() - start;
+        stats.add(CAstats::RENDER, ns);
+        if (tracing)
+            trace.event("render", CAtrace::SIMULATION, start, ns);
+    }
+    emit frameReady(damage);
+    damage = QRegion();
+    emit rewindRange(rewind.getOldest(), rewind.getNewest(), rewind.getCurrent());
+}
+
+
+QRgb Simulation::cellRgb(int v) {
+    /* dead and border cells stay transparent, living cells get the main color or the color of their type */
+    if (v <= 0)
+        return 0;
+    if (v == 1 || v >= 12 || universeMode == 7)
+        return palette[1];
+    return palette[v];
+}
+
+
+void Simulation::renderRow(int y, int x0, int x1, QRgb *line) {
+    /* the cyclic CA shows the states of the color universe, all other modes the cells */
+    if (universeMode == 3) {
+        const uint8_t *states = ca1.getColorRow(y);
+        for (int j = x0; j <= x1; j++)
+            line[j - 1] = cyclicPalette[states[j]];
+        return;
+    }
+    for (int j = x0; j <= x1; j++)
+        line[j - 1] = cellRgb(ca1.isAlive(j, y));
+}
+
+
+void Simulation::updatePalette() {
+    /* premultiplied pixels for all cell values, rebuilt when the main color changes */
+    palette[0] = 0;
+    palette[1] = qPremultiply(masterColor.rgba());
+    for (int v = 2; v < 12; v++)
+        palette[v] = qPremultiply(typeColor(v).rgba());
+    /* one turn of the color wheel over the states, so neighbouring states have similar colors */
+    int states = ca1.getCyclicStates();
+    for (int v = 0; v < 256; v++)
+        cyclicPalette[v] = QColor::fromHsv(360 * (v % states) / states, 200, 230).rgba();
+    imageStale = true;
+}
+
+
+QString Simulation::phaseText(CAstats &s, int phase) {
+    /* mean and percentiles over the last generations or frames, in milliseconds */
+    return tr("%1: %2 ms (p50 %3, p99 %4)")
+            .arg(CAstats::phaseName(phase))
+            .arg(s.getMean(phase) / 1e6, 0, 'f', 3)
+            .arg(s.getPercentile(phase, 0.5) / 1e6, 0, 'f', 3)
+            .arg(s.getPercentile(phase, 0.99) / 1e6, 0, 'f', 3);
+}
+
+
+QColor Simulation::typeColor(int v) {
+    /* color of the cell type v */
+    static const QColor cellColor[12] = {Qt::red,
+                                         Qt::darkRed,
+                                         Qt::green,
+                                         Qt::darkGreen,
+                                         Qt::blue,
+                                         Qt::darkBlue,
+                                         Qt::cyan,
+                                         Qt::darkCyan,
+                                         Qt::magenta,
+                                         Qt::darkMagenta,
+                                         Qt::yellow,
+                                         Qt::darkYellow};
+    return cellColor[v];
+}
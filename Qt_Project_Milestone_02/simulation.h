@@ -0,0 +1,176 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <QColor>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QObject>
+#include <QRegion>
+#include <QVector>
+#include <fstream>
+#include <vector>
+#include "CAbase.h"
+#include "CArecorder.h"
+#include "CArewind.h"
+#include "CAsnake.h"
+#include "CAsparse.h"
+#include "CAstats.h"
+#include "CAtriplebuffer.h"
+
+class QTimer;
+
+
+class Simulation : public QObject {
+    // Owns the universe and evolves it on its own thread (see GameWidget).
+    // All slots are invoked queued from the GUI thread, so the universe is only ever
+    // touched here. Every finished generation is rendered (one pixel per cell) and
+    // published through a triple buffer; the GUI reads the latest frame without blocking.
+
+    Q_OBJECT
+
+public:
+    enum { MIN_SIZE = 10, MAX_SIZE = 1000 }; // universe sizes of the size control, a loaded game must fit
+
+    // a frame: level 0 has one pixel per cell, level k one pixel per 2^k x 2^k cells with the
+    // mean of their colors (levels of detail, made while a level is larger than LOD_MIN)
+    typedef std::vector<QImage> Frame;
+
+    explicit Simulation(QObject *parent = 0);
+
+    const Frame &latestFrame(); // GUI thread only
+
+    static QColor typeColor(int v); // color of cells of type v (0 .. 11)
+    static QString phaseText(CAstats &s, int phase); // one line of the instrumentation readout
+
+    CAtrace *getTrace() {
+        // the GUI thread writes its paint events into the same trace, CAtrace is thread safe
+        return &trace;
+    }
+
+signals:
+    void frameReady(const QRegion &changed); // a new frame was published, changed cells (x - 1, y - 1)
+    void universeConstant(); // all the next generations will be the same
+    void universeCycle(qulonglong start, int period); // the universe repeats itself
+    void iterationsFinished(); // the requested number of generations is done
+    void rewindRange(qulonglong oldest, qulonglong newest, qulonglong current); // generations in the rewind buffer
+    void generationRate(double gensPerSecond); // measured about twice a second while running
+    void snakeEnded(bool won, int length); // the snake hit a wall or itself, or fills the universe
+    void statistics(const QString &text); // instrumentation readout, about twice a second while running
+
+public slots:
+    void startGame(int number);
+    void stopGame();
+    void clearGame();
+    void jumpGame(int number);
+
+    void setUniverseSize(int s);
+    void setUniverseMode(int m);
+    bool setRule(const QString &rule); // Life-like rulestring such as "B36/S23", false if invalid
+    void setCellMode(int m);
+    void setCyclic(int states, int threshold, bool moore); // "Cyclic CA" parameters
+    void setBoundary(int b); // CAbase::Boundary of the Life and cyclic universes
+    void setSeed(qulonglong seed); // start of the random numbers (splitmix64) of the next fields and snakes
+    void setInterval(int msec);
+    void setTurbo(bool on);
+    void setTurboRate(int gensPerSecond);
+    void setThreads(int n);
+    void setMasterColor(const QColor &color);
+
+    void editCell(int x, int y, bool toggle); // mouse edit of cell x, y
+    void editCells(const QVector<int> &cells, bool toggle); // x, y pairs of a stroke, one frame for all
+    void turnSnake(int direction); // CAsnake::Direction, taken at the next steps of the snake
+
+    QString dumpGame();
+    void reconstructGame(const QString &data);
+    bool saveGame(const QString &filename); // binary format, Life RLE for *.rle
+    bool loadGame(const QString &filename); // settings of the header are set by MainWindow first
+
+    bool startRecording(const QString &filename); // record every generation into a trajectory file
+    void stopRecording();
+    qlonglong openRecording(const QString &filename); // last generation of the recording, -1 on error
+    int seekRecording(qlonglong generation); // show a recorded generation, returns its universe size or 0
+
+    void stepBack(); // one generation back in the rewind buffer
+    void rewindTo(qlonglong generation); // any generation in the rewind buffer
+    void setRewindMemory(int megabytes); // memory for the rewind buffer, 0 = off
+
+    void setInstrumentation(bool on); // time the phases, count births and deaths, emit statistics
+    bool startStatsLog(const QString &filename); // one CSV line per generation
+    void stopStatsLog();
+    bool startTrace(const QString &filename); // Chrome trace of the phases (see CAstats.h)
+    void stopTrace();
+
+    void sync() {} // invoked blocking to wait until all queued calls are done
+
+private slots:
+    void newGeneration();
+
+private:
+    enum { FRAME_MSEC = 16 }; // frames are published at about 60 per second in turbo mode
+    enum { LOD_MIN = 64 }; // pixels in one row of the smallest level of detail (at least)
+
+    bool evolve();
+    void measureRate();
+    bool applyEdit(int x, int y, bool toggle); // false if the cell is left as it is
+    void render(bool tileDamage); // changed tiles into universeImage, their rectangles into damage
+    void reduceLevel(int k, int x0, int y0, int x1, int y1); // pixels x0 .. x1, y0 .. y1 of level k from level k - 1
+    void publish();
+    QRgb cellRgb(int v); // pixel of a cell with value v
+    void renderRow(int y, int x0, int x1, QRgb *line); // pixels of cells x0 .. x1 of row y
+    void updatePalette();
+    void seedCyclic(); // random states for the cyclic CA
+    void newSnake(); // new snake and food on the cleared universe
+    void instrument(int64_t start); // after the evolution of a generation that started at start
+
+    bool isMeasuring() {
+        return instrumented || statsLog.is_open() || tracing;
+    }
+
+    QTimer *timer;
+    int generations;
+    CAbase ca1;
+    CAsparse sparse; // universe of "Unbounded Life", ca1 shows a window of it
+    CArecorder recorder;
+    CArewind rewind;
+    CAplayer player;
+    CAsnake snake; // "Snake", drawn into the cells of ca1
+    int universeSize;
+    int universeMode;
+    int cellMode;
+    QColor masterColor;
+    int interval;
+    uint64_t randomSeed; // splitmix64 state of the random cyclic fields and the snakes
+
+    // turbo: run as many generations as fit into a frame (or turboRate per second),
+    // publish only one frame per FRAME_MSEC
+    bool turbo;
+    int turboRate;
+    QElapsedTimer frameClock;
+    QElapsedTimer turboClock;
+    qint64 turboDone; // generations since turboClock was started
+    QElapsedTimer rateClock;
+    qint64 rateCount; // generations since rateClock was started
+
+    // instrumentation: durations of evolution and rendering, the readout is formatted with
+    // the generation rate; the log and the trace are written while they are open
+    bool instrumented;
+    CAstats stats;
+    std::ofstream statsLog;
+    quint64 statsLogLines;
+    CAtrace trace;
+    bool tracing;
+
+    // frames: universeImage is kept up to date tile by tile, every buffer of the
+    // triple buffer remembers which tiles it still misses (stale); damage are the cells
+    // changed since the last frame, the GUI repaints only those
+    Frame universeImage;
+    QRegion damage;
+    bool imageStale;
+    QRgb palette[12];
+    QRgb cyclicPalette[256]; // color wheel over the states of the cyclic CA
+    CAtriplebuffer<Frame> frames;
+    std::vector<char> stale[3];
+};
+
+
+#endif // SIMULATION_H